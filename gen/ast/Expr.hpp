@@ -0,0 +1,663 @@
+// This is auto-generated by gen-ast.py. Do not modify manually.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "AstArena.hpp"
+#include "PropertyCache.hpp"
+#include "Token.hpp"
+
+namespace cloxx {
+
+class AssignExpr;
+class BinaryExpr;
+class CallExpr;
+class GetExpr;
+class GroupingExpr;
+class LiteralExpr;
+class LogicalExpr;
+class SetExpr;
+class ThisExpr;
+class SuperExpr;
+class UnaryExpr;
+class VariableExpr;
+
+class ExprVisitor {
+public:
+    virtual ~ExprVisitor() = default;
+
+    virtual void visit(AssignExpr const&) = 0;
+    virtual void visit(BinaryExpr const&) = 0;
+    virtual void visit(CallExpr const&) = 0;
+    virtual void visit(GetExpr const&) = 0;
+    virtual void visit(GroupingExpr const&) = 0;
+    virtual void visit(LiteralExpr const&) = 0;
+    virtual void visit(LogicalExpr const&) = 0;
+    virtual void visit(SetExpr const&) = 0;
+    virtual void visit(ThisExpr const&) = 0;
+    virtual void visit(SuperExpr const&) = 0;
+    virtual void visit(UnaryExpr const&) = 0;
+    virtual void visit(VariableExpr const&) = 0;
+};
+
+class ExprEvaluator {
+public:
+    virtual ~ExprEvaluator() = default;
+
+    virtual Value visit(AssignExpr const&) = 0;
+    virtual Value visit(BinaryExpr const&) = 0;
+    virtual Value visit(CallExpr const&) = 0;
+    virtual Value visit(GetExpr const&) = 0;
+    virtual Value visit(GroupingExpr const&) = 0;
+    virtual Value visit(LiteralExpr const&) = 0;
+    virtual Value visit(LogicalExpr const&) = 0;
+    virtual Value visit(SetExpr const&) = 0;
+    virtual Value visit(ThisExpr const&) = 0;
+    virtual Value visit(SuperExpr const&) = 0;
+    virtual Value visit(UnaryExpr const&) = 0;
+    virtual Value visit(VariableExpr const&) = 0;
+};
+
+// Refers to a node of any kind. Nodes are created in an AstArena, which owns
+// them, and are visited by switching on their kind.
+class Expr final {
+public:
+    enum class Kind : std::uint8_t {
+        ASSIGN,
+        BINARY,
+        CALL,
+        GET,
+        GROUPING,
+        LITERAL,
+        LOGICAL,
+        SET,
+        THIS,
+        SUPER,
+        UNARY,
+        VARIABLE,
+    };
+
+    struct Node {
+        Kind const kind;
+    };
+
+    Expr(AssignExpr const& node);
+    Expr(BinaryExpr const& node);
+    Expr(CallExpr const& node);
+    Expr(GetExpr const& node);
+    Expr(GroupingExpr const& node);
+    Expr(LiteralExpr const& node);
+    Expr(LogicalExpr const& node);
+    Expr(SetExpr const& node);
+    Expr(ThisExpr const& node);
+    Expr(SuperExpr const& node);
+    Expr(UnaryExpr const& node);
+    Expr(VariableExpr const& node);
+
+    AssignExpr const* toAssignExpr() const;
+    BinaryExpr const* toBinaryExpr() const;
+    CallExpr const* toCallExpr() const;
+    GetExpr const* toGetExpr() const;
+    GroupingExpr const* toGroupingExpr() const;
+    LiteralExpr const* toLiteralExpr() const;
+    LogicalExpr const* toLogicalExpr() const;
+    SetExpr const* toSetExpr() const;
+    ThisExpr const* toThisExpr() const;
+    SuperExpr const* toSuperExpr() const;
+    UnaryExpr const* toUnaryExpr() const;
+    VariableExpr const* toVariableExpr() const;
+
+    void accept(ExprVisitor& visitor) const;
+    Value accept(ExprEvaluator& visitor) const;
+
+private:
+    Node const* _node;
+};
+
+class AssignExpr final : public Expr::Node {
+public:
+    AssignExpr(Token const& name, Expr const& value);
+
+    AssignExpr(AssignExpr const&) = delete;
+    AssignExpr& operator=(AssignExpr const&) = delete;
+
+    Token const name;
+    Expr const value;
+
+    int depth() const;
+    int slot() const;
+    void resolve(int depth, int slot);
+
+private:
+    int _depth = -1;
+    int _slot = -1;
+};
+
+inline AssignExpr::AssignExpr(Token const& name, Expr const& value)
+    : Node{Expr::Kind::ASSIGN}, name{name}, value{value}
+{}
+
+inline int AssignExpr::depth() const
+{
+    return _depth;
+}
+
+inline int AssignExpr::slot() const
+{
+    return _slot;
+}
+
+inline void AssignExpr::resolve(int depth, int slot)
+{
+    _depth = depth;
+    _slot = slot;
+}
+
+inline AssignExpr const& makeAssignExpr(AstArena& arena, Token const& name, Expr const& value)
+{
+    return arena.create<AssignExpr>(name, value);
+}
+
+inline Expr::Expr(AssignExpr const& node) : _node{&node}
+{}
+
+inline AssignExpr const* Expr::toAssignExpr() const
+{
+    if (_node->kind == Kind::ASSIGN) {
+        return static_cast<AssignExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class BinaryExpr final : public Expr::Node {
+public:
+    BinaryExpr(Token const& op, Expr const& left, Expr const& right);
+
+    BinaryExpr(BinaryExpr const&) = delete;
+    BinaryExpr& operator=(BinaryExpr const&) = delete;
+
+    Token const op;
+    Expr const left;
+    Expr const right;
+};
+
+inline BinaryExpr::BinaryExpr(Token const& op, Expr const& left, Expr const& right)
+    : Node{Expr::Kind::BINARY}, op{op}, left{left}, right{right}
+{}
+
+inline BinaryExpr const& makeBinaryExpr(AstArena& arena, Token const& op, Expr const& left, Expr const& right)
+{
+    return arena.create<BinaryExpr>(op, left, right);
+}
+
+inline Expr::Expr(BinaryExpr const& node) : _node{&node}
+{}
+
+inline BinaryExpr const* Expr::toBinaryExpr() const
+{
+    if (_node->kind == Kind::BINARY) {
+        return static_cast<BinaryExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class CallExpr final : public Expr::Node {
+public:
+    CallExpr(Expr const& callee, Token const& paren, std::vector<Expr> const& args);
+
+    CallExpr(CallExpr const&) = delete;
+    CallExpr& operator=(CallExpr const&) = delete;
+
+    Expr const callee;
+    Token const paren;
+    std::vector<Expr> const args;
+};
+
+inline CallExpr::CallExpr(Expr const& callee, Token const& paren, std::vector<Expr> const& args)
+    : Node{Expr::Kind::CALL}, callee{callee}, paren{paren}, args{args}
+{}
+
+inline CallExpr const& makeCallExpr(AstArena& arena, Expr const& callee, Token const& paren, std::vector<Expr> const& args)
+{
+    return arena.create<CallExpr>(callee, paren, args);
+}
+
+inline Expr::Expr(CallExpr const& node) : _node{&node}
+{}
+
+inline CallExpr const* Expr::toCallExpr() const
+{
+    if (_node->kind == Kind::CALL) {
+        return static_cast<CallExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class GetExpr final : public Expr::Node {
+public:
+    GetExpr(Expr const& object, Token const& name);
+
+    GetExpr(GetExpr const&) = delete;
+    GetExpr& operator=(GetExpr const&) = delete;
+
+    Expr const object;
+    Token const name;
+    mutable PropertyCache cache{};
+};
+
+inline GetExpr::GetExpr(Expr const& object, Token const& name)
+    : Node{Expr::Kind::GET}, object{object}, name{name}
+{}
+
+inline GetExpr const& makeGetExpr(AstArena& arena, Expr const& object, Token const& name)
+{
+    return arena.create<GetExpr>(object, name);
+}
+
+inline Expr::Expr(GetExpr const& node) : _node{&node}
+{}
+
+inline GetExpr const* Expr::toGetExpr() const
+{
+    if (_node->kind == Kind::GET) {
+        return static_cast<GetExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class GroupingExpr final : public Expr::Node {
+public:
+    explicit GroupingExpr(Expr const& expr);
+
+    GroupingExpr(GroupingExpr const&) = delete;
+    GroupingExpr& operator=(GroupingExpr const&) = delete;
+
+    Expr const expr;
+};
+
+inline GroupingExpr::GroupingExpr(Expr const& expr)
+    : Node{Expr::Kind::GROUPING}, expr{expr}
+{}
+
+inline GroupingExpr const& makeGroupingExpr(AstArena& arena, Expr const& expr)
+{
+    return arena.create<GroupingExpr>(expr);
+}
+
+inline Expr::Expr(GroupingExpr const& node) : _node{&node}
+{}
+
+inline GroupingExpr const* Expr::toGroupingExpr() const
+{
+    if (_node->kind == Kind::GROUPING) {
+        return static_cast<GroupingExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class LiteralExpr final : public Expr::Node {
+public:
+    explicit LiteralExpr(Value const& value);
+
+    LiteralExpr(LiteralExpr const&) = delete;
+    LiteralExpr& operator=(LiteralExpr const&) = delete;
+
+    Value const value;
+};
+
+inline LiteralExpr::LiteralExpr(Value const& value)
+    : Node{Expr::Kind::LITERAL}, value{value}
+{}
+
+inline LiteralExpr const& makeLiteralExpr(AstArena& arena, Value const& value)
+{
+    return arena.create<LiteralExpr>(value);
+}
+
+inline Expr::Expr(LiteralExpr const& node) : _node{&node}
+{}
+
+inline LiteralExpr const* Expr::toLiteralExpr() const
+{
+    if (_node->kind == Kind::LITERAL) {
+        return static_cast<LiteralExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class LogicalExpr final : public Expr::Node {
+public:
+    LogicalExpr(Token const& op, Expr const& left, Expr const& right);
+
+    LogicalExpr(LogicalExpr const&) = delete;
+    LogicalExpr& operator=(LogicalExpr const&) = delete;
+
+    Token const op;
+    Expr const left;
+    Expr const right;
+};
+
+inline LogicalExpr::LogicalExpr(Token const& op, Expr const& left, Expr const& right)
+    : Node{Expr::Kind::LOGICAL}, op{op}, left{left}, right{right}
+{}
+
+inline LogicalExpr const& makeLogicalExpr(AstArena& arena, Token const& op, Expr const& left, Expr const& right)
+{
+    return arena.create<LogicalExpr>(op, left, right);
+}
+
+inline Expr::Expr(LogicalExpr const& node) : _node{&node}
+{}
+
+inline LogicalExpr const* Expr::toLogicalExpr() const
+{
+    if (_node->kind == Kind::LOGICAL) {
+        return static_cast<LogicalExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class SetExpr final : public Expr::Node {
+public:
+    SetExpr(Expr const& object, Token const& name, Expr const& value);
+
+    SetExpr(SetExpr const&) = delete;
+    SetExpr& operator=(SetExpr const&) = delete;
+
+    Expr const object;
+    Token const name;
+    Expr const value;
+    mutable PropertyCache cache{};
+};
+
+inline SetExpr::SetExpr(Expr const& object, Token const& name, Expr const& value)
+    : Node{Expr::Kind::SET}, object{object}, name{name}, value{value}
+{}
+
+inline SetExpr const& makeSetExpr(AstArena& arena, Expr const& object, Token const& name, Expr const& value)
+{
+    return arena.create<SetExpr>(object, name, value);
+}
+
+inline Expr::Expr(SetExpr const& node) : _node{&node}
+{}
+
+inline SetExpr const* Expr::toSetExpr() const
+{
+    if (_node->kind == Kind::SET) {
+        return static_cast<SetExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class ThisExpr final : public Expr::Node {
+public:
+    explicit ThisExpr(Token const& keyword);
+
+    ThisExpr(ThisExpr const&) = delete;
+    ThisExpr& operator=(ThisExpr const&) = delete;
+
+    Token const keyword;
+
+    int depth() const;
+    int slot() const;
+    void resolve(int depth, int slot);
+
+private:
+    int _depth = -1;
+    int _slot = -1;
+};
+
+inline ThisExpr::ThisExpr(Token const& keyword)
+    : Node{Expr::Kind::THIS}, keyword{keyword}
+{}
+
+inline int ThisExpr::depth() const
+{
+    return _depth;
+}
+
+inline int ThisExpr::slot() const
+{
+    return _slot;
+}
+
+inline void ThisExpr::resolve(int depth, int slot)
+{
+    _depth = depth;
+    _slot = slot;
+}
+
+inline ThisExpr const& makeThisExpr(AstArena& arena, Token const& keyword)
+{
+    return arena.create<ThisExpr>(keyword);
+}
+
+inline Expr::Expr(ThisExpr const& node) : _node{&node}
+{}
+
+inline ThisExpr const* Expr::toThisExpr() const
+{
+    if (_node->kind == Kind::THIS) {
+        return static_cast<ThisExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class SuperExpr final : public Expr::Node {
+public:
+    SuperExpr(Token const& keyword, Token const& method);
+
+    SuperExpr(SuperExpr const&) = delete;
+    SuperExpr& operator=(SuperExpr const&) = delete;
+
+    Token const keyword;
+    Token const method;
+
+    int depth() const;
+    int slot() const;
+    void resolve(int depth, int slot);
+
+private:
+    int _depth = -1;
+    int _slot = -1;
+};
+
+inline SuperExpr::SuperExpr(Token const& keyword, Token const& method)
+    : Node{Expr::Kind::SUPER}, keyword{keyword}, method{method}
+{}
+
+inline int SuperExpr::depth() const
+{
+    return _depth;
+}
+
+inline int SuperExpr::slot() const
+{
+    return _slot;
+}
+
+inline void SuperExpr::resolve(int depth, int slot)
+{
+    _depth = depth;
+    _slot = slot;
+}
+
+inline SuperExpr const& makeSuperExpr(AstArena& arena, Token const& keyword, Token const& method)
+{
+    return arena.create<SuperExpr>(keyword, method);
+}
+
+inline Expr::Expr(SuperExpr const& node) : _node{&node}
+{}
+
+inline SuperExpr const* Expr::toSuperExpr() const
+{
+    if (_node->kind == Kind::SUPER) {
+        return static_cast<SuperExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class UnaryExpr final : public Expr::Node {
+public:
+    UnaryExpr(Token const& op, Expr const& right);
+
+    UnaryExpr(UnaryExpr const&) = delete;
+    UnaryExpr& operator=(UnaryExpr const&) = delete;
+
+    Token const op;
+    Expr const right;
+};
+
+inline UnaryExpr::UnaryExpr(Token const& op, Expr const& right)
+    : Node{Expr::Kind::UNARY}, op{op}, right{right}
+{}
+
+inline UnaryExpr const& makeUnaryExpr(AstArena& arena, Token const& op, Expr const& right)
+{
+    return arena.create<UnaryExpr>(op, right);
+}
+
+inline Expr::Expr(UnaryExpr const& node) : _node{&node}
+{}
+
+inline UnaryExpr const* Expr::toUnaryExpr() const
+{
+    if (_node->kind == Kind::UNARY) {
+        return static_cast<UnaryExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+class VariableExpr final : public Expr::Node {
+public:
+    explicit VariableExpr(Token const& name);
+
+    VariableExpr(VariableExpr const&) = delete;
+    VariableExpr& operator=(VariableExpr const&) = delete;
+
+    Token const name;
+
+    int depth() const;
+    int slot() const;
+    void resolve(int depth, int slot);
+
+private:
+    int _depth = -1;
+    int _slot = -1;
+};
+
+inline VariableExpr::VariableExpr(Token const& name)
+    : Node{Expr::Kind::VARIABLE}, name{name}
+{}
+
+inline int VariableExpr::depth() const
+{
+    return _depth;
+}
+
+inline int VariableExpr::slot() const
+{
+    return _slot;
+}
+
+inline void VariableExpr::resolve(int depth, int slot)
+{
+    _depth = depth;
+    _slot = slot;
+}
+
+inline VariableExpr const& makeVariableExpr(AstArena& arena, Token const& name)
+{
+    return arena.create<VariableExpr>(name);
+}
+
+inline Expr::Expr(VariableExpr const& node) : _node{&node}
+{}
+
+inline VariableExpr const* Expr::toVariableExpr() const
+{
+    if (_node->kind == Kind::VARIABLE) {
+        return static_cast<VariableExpr const*>(_node);
+    }
+    return nullptr;
+}
+
+inline void Expr::accept(ExprVisitor& visitor) const
+{
+    switch (_node->kind) {
+    case Kind::ASSIGN:
+        visitor.visit(static_cast<AssignExpr const&>(*_node));
+        return;
+    case Kind::BINARY:
+        visitor.visit(static_cast<BinaryExpr const&>(*_node));
+        return;
+    case Kind::CALL:
+        visitor.visit(static_cast<CallExpr const&>(*_node));
+        return;
+    case Kind::GET:
+        visitor.visit(static_cast<GetExpr const&>(*_node));
+        return;
+    case Kind::GROUPING:
+        visitor.visit(static_cast<GroupingExpr const&>(*_node));
+        return;
+    case Kind::LITERAL:
+        visitor.visit(static_cast<LiteralExpr const&>(*_node));
+        return;
+    case Kind::LOGICAL:
+        visitor.visit(static_cast<LogicalExpr const&>(*_node));
+        return;
+    case Kind::SET:
+        visitor.visit(static_cast<SetExpr const&>(*_node));
+        return;
+    case Kind::THIS:
+        visitor.visit(static_cast<ThisExpr const&>(*_node));
+        return;
+    case Kind::SUPER:
+        visitor.visit(static_cast<SuperExpr const&>(*_node));
+        return;
+    case Kind::UNARY:
+        visitor.visit(static_cast<UnaryExpr const&>(*_node));
+        return;
+    case Kind::VARIABLE:
+        visitor.visit(static_cast<VariableExpr const&>(*_node));
+        return;
+    }
+}
+
+inline Value Expr::accept(ExprEvaluator& visitor) const
+{
+    switch (_node->kind) {
+    case Kind::ASSIGN:
+        return visitor.visit(static_cast<AssignExpr const&>(*_node));
+    case Kind::BINARY:
+        return visitor.visit(static_cast<BinaryExpr const&>(*_node));
+    case Kind::CALL:
+        return visitor.visit(static_cast<CallExpr const&>(*_node));
+    case Kind::GET:
+        return visitor.visit(static_cast<GetExpr const&>(*_node));
+    case Kind::GROUPING:
+        return visitor.visit(static_cast<GroupingExpr const&>(*_node));
+    case Kind::LITERAL:
+        return visitor.visit(static_cast<LiteralExpr const&>(*_node));
+    case Kind::LOGICAL:
+        return visitor.visit(static_cast<LogicalExpr const&>(*_node));
+    case Kind::SET:
+        return visitor.visit(static_cast<SetExpr const&>(*_node));
+    case Kind::THIS:
+        return visitor.visit(static_cast<ThisExpr const&>(*_node));
+    case Kind::SUPER:
+        return visitor.visit(static_cast<SuperExpr const&>(*_node));
+    case Kind::UNARY:
+        return visitor.visit(static_cast<UnaryExpr const&>(*_node));
+    case Kind::VARIABLE:
+        return visitor.visit(static_cast<VariableExpr const&>(*_node));
+    }
+    return {}; // unreachable
+}
+
+} // cloxx
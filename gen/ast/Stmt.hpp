@@ -0,0 +1,473 @@
+// This is auto-generated by gen-ast.py. Do not modify manually.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "AstArena.hpp"
+#include "Token.hpp"
+#include "Expr.hpp"
+
+namespace cloxx {
+
+class BlockStmt;
+class ExprStmt;
+class IfStmt;
+class WhileStmt;
+class ReturnStmt;
+class PrintStmt;
+class VarStmt;
+class FunStmt;
+class ClassStmt;
+
+class StmtVisitor {
+public:
+    virtual ~StmtVisitor() = default;
+
+    virtual void visit(BlockStmt const&) = 0;
+    virtual void visit(ExprStmt const&) = 0;
+    virtual void visit(IfStmt const&) = 0;
+    virtual void visit(WhileStmt const&) = 0;
+    virtual void visit(ReturnStmt const&) = 0;
+    virtual void visit(PrintStmt const&) = 0;
+    virtual void visit(VarStmt const&) = 0;
+    virtual void visit(FunStmt const&) = 0;
+    virtual void visit(ClassStmt const&) = 0;
+};
+
+// Refers to a node of any kind. Nodes are created in an AstArena, which owns
+// them, and are visited by switching on their kind.
+class Stmt final {
+public:
+    enum class Kind : std::uint8_t {
+        BLOCK,
+        EXPR,
+        IF,
+        WHILE,
+        RETURN,
+        PRINT,
+        VAR,
+        FUN,
+        CLASS,
+    };
+
+    struct Node {
+        Kind const kind;
+    };
+
+    Stmt(BlockStmt const& node);
+    Stmt(ExprStmt const& node);
+    Stmt(IfStmt const& node);
+    Stmt(WhileStmt const& node);
+    Stmt(ReturnStmt const& node);
+    Stmt(PrintStmt const& node);
+    Stmt(VarStmt const& node);
+    Stmt(FunStmt const& node);
+    Stmt(ClassStmt const& node);
+
+    BlockStmt const* toBlockStmt() const;
+    ExprStmt const* toExprStmt() const;
+    IfStmt const* toIfStmt() const;
+    WhileStmt const* toWhileStmt() const;
+    ReturnStmt const* toReturnStmt() const;
+    PrintStmt const* toPrintStmt() const;
+    VarStmt const* toVarStmt() const;
+    FunStmt const* toFunStmt() const;
+    ClassStmt const* toClassStmt() const;
+
+    void accept(StmtVisitor& visitor) const;
+
+private:
+    Node const* _node;
+};
+
+class BlockStmt final : public Stmt::Node {
+public:
+    explicit BlockStmt(std::vector<Stmt> const& stmts);
+
+    BlockStmt(BlockStmt const&) = delete;
+    BlockStmt& operator=(BlockStmt const&) = delete;
+
+    std::vector<Stmt> const stmts;
+    mutable std::vector<bool> captured{};
+};
+
+inline BlockStmt::BlockStmt(std::vector<Stmt> const& stmts)
+    : Node{Stmt::Kind::BLOCK}, stmts{stmts}
+{}
+
+inline BlockStmt const& makeBlockStmt(AstArena& arena, std::vector<Stmt> const& stmts)
+{
+    return arena.create<BlockStmt>(stmts);
+}
+
+inline Stmt::Stmt(BlockStmt const& node) : _node{&node}
+{}
+
+inline BlockStmt const* Stmt::toBlockStmt() const
+{
+    if (_node->kind == Kind::BLOCK) {
+        return static_cast<BlockStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+class ExprStmt final : public Stmt::Node {
+public:
+    explicit ExprStmt(Expr const& expr);
+
+    ExprStmt(ExprStmt const&) = delete;
+    ExprStmt& operator=(ExprStmt const&) = delete;
+
+    Expr const expr;
+};
+
+inline ExprStmt::ExprStmt(Expr const& expr)
+    : Node{Stmt::Kind::EXPR}, expr{expr}
+{}
+
+inline ExprStmt const& makeExprStmt(AstArena& arena, Expr const& expr)
+{
+    return arena.create<ExprStmt>(expr);
+}
+
+inline Stmt::Stmt(ExprStmt const& node) : _node{&node}
+{}
+
+inline ExprStmt const* Stmt::toExprStmt() const
+{
+    if (_node->kind == Kind::EXPR) {
+        return static_cast<ExprStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+class IfStmt final : public Stmt::Node {
+public:
+    IfStmt(Expr const& cond, Stmt const& thenBranch, std::optional<Stmt> const& elseBranch);
+
+    IfStmt(IfStmt const&) = delete;
+    IfStmt& operator=(IfStmt const&) = delete;
+
+    Expr const cond;
+    Stmt const thenBranch;
+    std::optional<Stmt> const elseBranch;
+};
+
+inline IfStmt::IfStmt(Expr const& cond, Stmt const& thenBranch, std::optional<Stmt> const& elseBranch)
+    : Node{Stmt::Kind::IF}, cond{cond}, thenBranch{thenBranch}, elseBranch{elseBranch}
+{}
+
+inline IfStmt const& makeIfStmt(AstArena& arena, Expr const& cond, Stmt const& thenBranch, std::optional<Stmt> const& elseBranch)
+{
+    return arena.create<IfStmt>(cond, thenBranch, elseBranch);
+}
+
+inline Stmt::Stmt(IfStmt const& node) : _node{&node}
+{}
+
+inline IfStmt const* Stmt::toIfStmt() const
+{
+    if (_node->kind == Kind::IF) {
+        return static_cast<IfStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+class WhileStmt final : public Stmt::Node {
+public:
+    WhileStmt(Expr const& cond, Stmt const& body);
+
+    WhileStmt(WhileStmt const&) = delete;
+    WhileStmt& operator=(WhileStmt const&) = delete;
+
+    Expr const cond;
+    Stmt const body;
+};
+
+inline WhileStmt::WhileStmt(Expr const& cond, Stmt const& body)
+    : Node{Stmt::Kind::WHILE}, cond{cond}, body{body}
+{}
+
+inline WhileStmt const& makeWhileStmt(AstArena& arena, Expr const& cond, Stmt const& body)
+{
+    return arena.create<WhileStmt>(cond, body);
+}
+
+inline Stmt::Stmt(WhileStmt const& node) : _node{&node}
+{}
+
+inline WhileStmt const* Stmt::toWhileStmt() const
+{
+    if (_node->kind == Kind::WHILE) {
+        return static_cast<WhileStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+class ReturnStmt final : public Stmt::Node {
+public:
+    ReturnStmt(Token const& keyword, std::optional<Expr> const& value);
+
+    ReturnStmt(ReturnStmt const&) = delete;
+    ReturnStmt& operator=(ReturnStmt const&) = delete;
+
+    Token const keyword;
+    std::optional<Expr> const value;
+};
+
+inline ReturnStmt::ReturnStmt(Token const& keyword, std::optional<Expr> const& value)
+    : Node{Stmt::Kind::RETURN}, keyword{keyword}, value{value}
+{}
+
+inline ReturnStmt const& makeReturnStmt(AstArena& arena, Token const& keyword, std::optional<Expr> const& value)
+{
+    return arena.create<ReturnStmt>(keyword, value);
+}
+
+inline Stmt::Stmt(ReturnStmt const& node) : _node{&node}
+{}
+
+inline ReturnStmt const* Stmt::toReturnStmt() const
+{
+    if (_node->kind == Kind::RETURN) {
+        return static_cast<ReturnStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+class PrintStmt final : public Stmt::Node {
+public:
+    explicit PrintStmt(Expr const& expr);
+
+    PrintStmt(PrintStmt const&) = delete;
+    PrintStmt& operator=(PrintStmt const&) = delete;
+
+    Expr const expr;
+};
+
+inline PrintStmt::PrintStmt(Expr const& expr)
+    : Node{Stmt::Kind::PRINT}, expr{expr}
+{}
+
+inline PrintStmt const& makePrintStmt(AstArena& arena, Expr const& expr)
+{
+    return arena.create<PrintStmt>(expr);
+}
+
+inline Stmt::Stmt(PrintStmt const& node) : _node{&node}
+{}
+
+inline PrintStmt const* Stmt::toPrintStmt() const
+{
+    if (_node->kind == Kind::PRINT) {
+        return static_cast<PrintStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+class VarStmt final : public Stmt::Node {
+public:
+    VarStmt(Token const& name, std::optional<Expr> const& initializer);
+
+    VarStmt(VarStmt const&) = delete;
+    VarStmt& operator=(VarStmt const&) = delete;
+
+    Token const name;
+    std::optional<Expr> const initializer;
+
+    int depth() const;
+    int slot() const;
+    void resolve(int depth, int slot);
+
+private:
+    int _depth = -1;
+    int _slot = -1;
+};
+
+inline VarStmt::VarStmt(Token const& name, std::optional<Expr> const& initializer)
+    : Node{Stmt::Kind::VAR}, name{name}, initializer{initializer}
+{}
+
+inline int VarStmt::depth() const
+{
+    return _depth;
+}
+
+inline int VarStmt::slot() const
+{
+    return _slot;
+}
+
+inline void VarStmt::resolve(int depth, int slot)
+{
+    _depth = depth;
+    _slot = slot;
+}
+
+inline VarStmt const& makeVarStmt(AstArena& arena, Token const& name, std::optional<Expr> const& initializer)
+{
+    return arena.create<VarStmt>(name, initializer);
+}
+
+inline Stmt::Stmt(VarStmt const& node) : _node{&node}
+{}
+
+inline VarStmt const* Stmt::toVarStmt() const
+{
+    if (_node->kind == Kind::VAR) {
+        return static_cast<VarStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+class FunStmt final : public Stmt::Node {
+public:
+    FunStmt(Token const& name, std::vector<Token> const& params, std::vector<Stmt> const& body);
+
+    FunStmt(FunStmt const&) = delete;
+    FunStmt& operator=(FunStmt const&) = delete;
+
+    Token const name;
+    std::vector<Token> const params;
+    std::vector<Stmt> const body;
+    mutable size_t frameSize{};
+    mutable std::vector<bool> captured{};
+
+    int depth() const;
+    int slot() const;
+    void resolve(int depth, int slot);
+
+private:
+    int _depth = -1;
+    int _slot = -1;
+};
+
+inline FunStmt::FunStmt(Token const& name, std::vector<Token> const& params, std::vector<Stmt> const& body)
+    : Node{Stmt::Kind::FUN}, name{name}, params{params}, body{body}
+{}
+
+inline int FunStmt::depth() const
+{
+    return _depth;
+}
+
+inline int FunStmt::slot() const
+{
+    return _slot;
+}
+
+inline void FunStmt::resolve(int depth, int slot)
+{
+    _depth = depth;
+    _slot = slot;
+}
+
+inline FunStmt const& makeFunStmt(AstArena& arena, Token const& name, std::vector<Token> const& params, std::vector<Stmt> const& body)
+{
+    return arena.create<FunStmt>(name, params, body);
+}
+
+inline Stmt::Stmt(FunStmt const& node) : _node{&node}
+{}
+
+inline FunStmt const* Stmt::toFunStmt() const
+{
+    if (_node->kind == Kind::FUN) {
+        return static_cast<FunStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+class ClassStmt final : public Stmt::Node {
+public:
+    ClassStmt(Token const& name, VariableExpr const* superclass, std::vector<FunStmt const*> const& methods);
+
+    ClassStmt(ClassStmt const&) = delete;
+    ClassStmt& operator=(ClassStmt const&) = delete;
+
+    Token const name;
+    VariableExpr const* const superclass;
+    std::vector<FunStmt const*> const methods;
+
+    int depth() const;
+    int slot() const;
+    void resolve(int depth, int slot);
+
+private:
+    int _depth = -1;
+    int _slot = -1;
+};
+
+inline ClassStmt::ClassStmt(Token const& name, VariableExpr const* superclass, std::vector<FunStmt const*> const& methods)
+    : Node{Stmt::Kind::CLASS}, name{name}, superclass{superclass}, methods{methods}
+{}
+
+inline int ClassStmt::depth() const
+{
+    return _depth;
+}
+
+inline int ClassStmt::slot() const
+{
+    return _slot;
+}
+
+inline void ClassStmt::resolve(int depth, int slot)
+{
+    _depth = depth;
+    _slot = slot;
+}
+
+inline ClassStmt const& makeClassStmt(AstArena& arena, Token const& name, VariableExpr const* superclass, std::vector<FunStmt const*> const& methods)
+{
+    return arena.create<ClassStmt>(name, superclass, methods);
+}
+
+inline Stmt::Stmt(ClassStmt const& node) : _node{&node}
+{}
+
+inline ClassStmt const* Stmt::toClassStmt() const
+{
+    if (_node->kind == Kind::CLASS) {
+        return static_cast<ClassStmt const*>(_node);
+    }
+    return nullptr;
+}
+
+inline void Stmt::accept(StmtVisitor& visitor) const
+{
+    switch (_node->kind) {
+    case Kind::BLOCK:
+        visitor.visit(static_cast<BlockStmt const&>(*_node));
+        return;
+    case Kind::EXPR:
+        visitor.visit(static_cast<ExprStmt const&>(*_node));
+        return;
+    case Kind::IF:
+        visitor.visit(static_cast<IfStmt const&>(*_node));
+        return;
+    case Kind::WHILE:
+        visitor.visit(static_cast<WhileStmt const&>(*_node));
+        return;
+    case Kind::RETURN:
+        visitor.visit(static_cast<ReturnStmt const&>(*_node));
+        return;
+    case Kind::PRINT:
+        visitor.visit(static_cast<PrintStmt const&>(*_node));
+        return;
+    case Kind::VAR:
+        visitor.visit(static_cast<VarStmt const&>(*_node));
+        return;
+    case Kind::FUN:
+        visitor.visit(static_cast<FunStmt const&>(*_node));
+        return;
+    case Kind::CLASS:
+        visitor.visit(static_cast<ClassStmt const&>(*_node));
+        return;
+    }
+}
+
+} // cloxx
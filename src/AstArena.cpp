@@ -0,0 +1,30 @@
+#include "AstArena.hpp"
+
+#include <algorithm>
+
+namespace cloxx {
+
+AstArena::~AstArena()
+{
+    // Later nodes may refer to earlier ones, so destroy them the other way.
+    for (auto it = _destructors.rbegin(); it != _destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+    for (auto block : _blocks) {
+        ::operator delete(block);
+    }
+}
+
+void* AstArena::refill(size_t size)
+{
+    auto capacity = std::max(size, blockSize);
+    _blocks.reserve(_blocks.size() + 1);
+    auto block = static_cast<char*>(::operator new(capacity));
+    _blocks.push_back(block);
+
+    _next = block;
+    _end = block + capacity;
+    return block;
+}
+
+} // namespace cloxx
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cloxx {
+
+// AstArena owns the nodes of syntax trees. Nodes are bump-allocated next to
+// each other in large blocks, in the order the parser makes them, and live as
+// long as the arena does, so they need neither reference counts nor a heap
+// allocation of their own.
+class AstArena {
+public:
+    AstArena() = default;
+    ~AstArena();
+
+    AstArena(AstArena const&) = delete;
+    AstArena& operator=(AstArena const&) = delete;
+
+    template <typename T, typename... Args>
+    T& create(Args&&... args)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t));
+
+        auto node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            _destructors.push_back({node, [](void* object) { static_cast<T*>(object)->~T(); }});
+        }
+        return *node;
+    }
+
+private:
+    void* allocate(size_t size, size_t alignment)
+    {
+        auto space = static_cast<size_t>(_end - _next);
+        void* memory = _next;
+        if (!std::align(alignment, size, memory, space)) {
+            memory = refill(size);
+        }
+        _next = static_cast<char*>(memory) + size;
+        return memory;
+    }
+
+    void* refill(size_t size);
+
+    static constexpr size_t blockSize = 64 * 1024;
+
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    char* _next = nullptr;
+    char* _end = nullptr;
+    std::vector<void*> _blocks;
+    std::vector<Destructor> _destructors;
+};
+
+} // namespace cloxx
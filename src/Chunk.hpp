@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "LoxFunction.hpp"
+#include "PropertyCache.hpp"
+#include "Token.hpp"
+#include "Value.hpp"
+#include "ast/Stmt.hpp"
+
+namespace cloxx {
+
+// Instructions of the VM with their operands. Operands are 32 bits, stored
+// unaligned in native byte order, so that no depth, slot or index the
+// resolver hands out is ever too large for them. Local variables live in
+// slots of the frame of their function, except for those closures capture,
+// which live in environments. Depths of captured variables count only the
+// scopes that have an environment.
+// Tokens are used to name properties and to report runtime errors.
+#define CLOXX_OPCODES(X)                                                                                               \
+    X(CONSTANT)      /* u32 constant */                                                                                \
+    X(NIL)                                                                                                             \
+    X(TRUE)                                                                                                            \
+    X(FALSE)                                                                                                           \
+    X(POP)                                                                                                             \
+    X(DEFINE_LOCAL)  /* u32 slot: pops the value into a slot of the frame */                                           \
+    X(DEFINE_CAPTURED) /* u32 slot: pops the value into the current environment */                                     \
+    X(DEFINE_GLOBAL) /* u32 slot */                                                                                    \
+    X(GET_LOCAL)     /* u32 slot */                                                                                    \
+    X(SET_LOCAL)     /* u32 slot */                                                                                    \
+    X(GET_CAPTURED)  /* u32 depth, u32 slot */                                                                         \
+    X(SET_CAPTURED)  /* u32 depth, u32 slot */                                                                         \
+    X(GET_GLOBAL)    /* u32 slot, u32 name token */                                                                    \
+    X(SET_GLOBAL)    /* u32 slot, u32 name token */                                                                    \
+    X(GET_PROPERTY)  /* u32 name token, u32 cache */                                                                   \
+    X(CHECK_FIELDS)  /* u32 name token: fails unless the value on top is an instance */                                \
+    X(SET_PROPERTY)  /* u32 name token, u32 cache */                                                                   \
+    X(GET_SUPER)     /* u32 depth, u32 method token: binds the method to the instance on top */                        \
+    X(GET_METHOD)    /* u32 name token, u32 cache: pushes the method and the instance, or the field and nil */         \
+    X(GET_SUPER_METHOD) /* u32 depth, u32 method token: pushes the method below the instance on top */                 \
+    X(EQUAL)                                                                                                           \
+    X(NOT_EQUAL)                                                                                                       \
+    X(GREATER)       /* u32 operator token */                                                                          \
+    X(GREATER_EQUAL) /* u32 operator token */                                                                          \
+    X(LESS)          /* u32 operator token */                                                                          \
+    X(LESS_EQUAL)    /* u32 operator token */                                                                          \
+    X(ADD)           /* u32 operator token */                                                                          \
+    X(SUBTRACT)      /* u32 operator token */                                                                          \
+    X(MULTIPLY)      /* u32 operator token */                                                                          \
+    X(DIVIDE)        /* u32 operator token */                                                                          \
+    X(NOT)                                                                                                             \
+    X(NEGATE)        /* u32 operator token */                                                                          \
+    X(PRINT)                                                                                                           \
+    X(JUMP)          /* u32 offset */                                                                                  \
+    X(JUMP_IF_FALSE) /* u32 offset: leaves the condition on the stack */                                               \
+    X(JUMP_IF_TRUE)  /* u32 offset: leaves the condition on the stack */                                               \
+    X(POP_JUMP_IF_FALSE) /* u32 offset */                                                                              \
+    X(LOOP)          /* u32 offset: jumps backwards, a safe point */                                                   \
+    X(CALL)          /* u32 argument count, u32 paren token */                                                         \
+    X(INVOKE)        /* u32 argument count, u32 paren token: calls below the arguments on the instance, if not nil */  \
+    X(CLOSURE)       /* u32 function */                                                                                \
+    X(CLASS)         /* u32 class: pops the superclass, if any, and pushes the class */                                \
+    X(PUSH_SCOPE)    /* u32 slot count: enters an environment for captured variables */                               \
+    X(POP_SCOPE)                                                                                                       \
+    X(RETURN)
+
+enum class OpCode : std::uint8_t {
+#define CLOXX_OPCODE_ENUM(name) name,
+    CLOXX_OPCODES(CLOXX_OPCODE_ENUM)
+#undef CLOXX_OPCODE_ENUM
+};
+
+struct Chunk;
+
+struct FunctionInfo {
+    FunStmt const& declaration;
+    bool isInitializer;
+    std::unique_ptr<Chunk> chunk;
+
+    // Made by the VM the first time it makes a function of this
+    mutable std::unique_ptr<FunctionProto> proto;
+};
+
+struct ClassInfo {
+    Token name;
+    std::optional<Token> superclass;
+    std::vector<std::uint32_t> methods; // into Chunk::functions
+};
+
+// Bytecode of a function body or of top-level statements, with the tables
+// its instructions refer to.
+struct Chunk {
+    std::vector<std::uint8_t> code;
+    std::vector<Value> constants;
+    std::vector<Token> tokens;
+    std::vector<FunctionInfo> functions;
+    std::vector<ClassInfo> classes;
+
+    // One for each instruction accessing properties, filled in as it runs
+    mutable std::vector<PropertyCache> caches;
+
+    // Slots of the frame: "this" for methods and the arguments come first,
+    // then the variables of the body that no closure captures.
+    size_t argumentSlots = 0;
+    size_t localSlots = 0;
+
+    // Most values the code ever has on the stack at once above the slots
+    size_t maxStackDepth = 0;
+};
+
+inline std::uint32_t readU32(std::uint8_t const*& ip)
+{
+    std::uint32_t value;
+    std::memcpy(&value, ip, sizeof(value));
+    ip += sizeof(value);
+    return value;
+}
+
+} // namespace cloxx
@@ -0,0 +1,916 @@
+#include "ClosureInterpreter.hpp"
+
+#include <functional>
+#include <iostream> // for print statement
+#include <map>
+#include <optional>
+
+#include "Assert.hpp"
+#include "Environment.hpp"
+#include "GC.hpp"
+#include "Lox.hpp"
+#include "LoxClass.hpp"
+#include "LoxFunction.hpp"
+#include "LoxInstance.hpp"
+#include "LoxObject.hpp"
+#include "PropertyCache.hpp"
+#include "RuntimeError.hpp"
+
+namespace cloxx {
+
+struct ClosureInterpreter::Context {
+    GarbageCollector* const gc;
+    PropertyCacheStats* const cacheStats;
+    Environment* const globals;
+    Environment* environment;
+
+    // Set by a return statement for the function body it unwinds to.
+    Value returnValue;
+};
+
+struct ClosureInterpreter::ExprNode {
+    using Eval = Value (*)(ExprNode const& node, Context& context);
+
+    explicit ExprNode(Eval eval) : eval{eval}
+    {}
+
+    virtual ~ExprNode() = default;
+
+    Value operator()(Context& context) const
+    {
+        return eval(*this, context);
+    }
+
+    Eval const eval;
+};
+
+// Running a statement returns true if it ran into a return statement, which
+// unwinds to the function body this way instead of throwing.
+struct ClosureInterpreter::StmtNode {
+    using Exec = bool (*)(StmtNode const& node, Context& context);
+
+    explicit StmtNode(Exec exec) : exec{exec}
+    {}
+
+    virtual ~StmtNode() = default;
+
+    bool operator()(Context& context) const
+    {
+        return exec(*this, context);
+    }
+
+    Exec const exec;
+};
+
+struct ClosureInterpreter::FunctionNode {
+    FunctionNode(FunStmt const& declaration, bool isInitializer, std::vector<StmtPtr> body, Context& context);
+
+    std::vector<StmtPtr> const body;
+    FunctionProto const proto; // runs `body`
+};
+
+namespace {
+using Context = ClosureInterpreter::Context;
+using ExprNode = ClosureInterpreter::ExprNode;
+using StmtNode = ClosureInterpreter::StmtNode;
+using FunctionNode = ClosureInterpreter::FunctionNode;
+using ExprPtr = std::unique_ptr<ExprNode>;
+using StmtPtr = std::unique_ptr<StmtNode>;
+
+// Expression nodes. The compiler picks the function that evaluates each of
+// them, e.g. per operator, so they only hold what that function needs.
+
+struct Constant : ExprNode {
+    Constant(Eval eval, Value value) : ExprNode{eval}, value{value}
+    {}
+
+    Value const value;
+};
+
+struct Variable : ExprNode {
+    Variable(Eval eval, Token const& name, int depth, int slot) : ExprNode{eval}, name{name}, depth{depth}, slot{slot}
+    {}
+
+    Token const name;
+    int const depth;
+    int const slot;
+};
+
+struct Assign : Variable {
+    Assign(Eval eval, Token const& name, int depth, int slot, ExprPtr value)
+        : Variable{eval, name, depth, slot}, value{std::move(value)}
+    {}
+
+    ExprPtr const value;
+};
+
+struct Binary : ExprNode {
+    Binary(Eval eval, Token const& op, ExprPtr left, ExprPtr right)
+        : ExprNode{eval}, op{op}, left{std::move(left)}, right{std::move(right)}
+    {}
+
+    Token const op;
+    ExprPtr const left;
+    ExprPtr const right;
+};
+
+struct Unary : ExprNode {
+    Unary(Eval eval, Token const& op, ExprPtr right) : ExprNode{eval}, op{op}, right{std::move(right)}
+    {}
+
+    Token const op;
+    ExprPtr const right;
+};
+
+struct Call : ExprNode {
+    Call(Eval eval, Token const& paren, ExprPtr callee, std::vector<ExprPtr> args)
+        : ExprNode{eval}, paren{paren}, callee{std::move(callee)}, args{std::move(args)}
+    {}
+
+    Token const paren;
+    ExprPtr const callee;
+    std::vector<ExprPtr> const args;
+};
+
+struct Property : ExprNode {
+    Property(Eval eval, Token const& name, ExprPtr object, ExprPtr value)
+        : ExprNode{eval}, name{name}, object{std::move(object)}, value{std::move(value)}
+    {}
+
+    Token const name;
+    ExprPtr const object;
+    ExprPtr const value; // only for setters
+    mutable PropertyCache cache;
+};
+
+struct Super : ExprNode {
+    Super(Eval eval, Token const& method, int depth) : ExprNode{eval}, method{method}, depth{depth}
+    {}
+
+    Token const method;
+    int const depth;
+};
+
+// Statement nodes
+
+struct Expression : StmtNode {
+    Expression(Exec exec, ExprPtr expr) : StmtNode{exec}, expr{std::move(expr)}
+    {}
+
+    ExprPtr const expr;
+};
+
+struct Var : StmtNode {
+    Var(Exec exec, int slot, ExprPtr initializer) : StmtNode{exec}, slot{slot}, initializer{std::move(initializer)}
+    {}
+
+    int const slot;
+    ExprPtr const initializer;
+};
+
+struct Block : StmtNode {
+    Block(Exec exec, std::vector<StmtPtr> stmts) : StmtNode{exec}, stmts{std::move(stmts)}
+    {}
+
+    std::vector<StmtPtr> const stmts;
+};
+
+struct If : StmtNode {
+    If(Exec exec, ExprPtr cond, StmtPtr thenBranch, StmtPtr elseBranch)
+        : StmtNode{exec}, cond{std::move(cond)}, thenBranch{std::move(thenBranch)}, elseBranch{std::move(elseBranch)}
+    {}
+
+    ExprPtr const cond;
+    StmtPtr const thenBranch;
+    StmtPtr const elseBranch; // may be null
+};
+
+struct While : StmtNode {
+    While(Exec exec, ExprPtr cond, StmtPtr body) : StmtNode{exec}, cond{std::move(cond)}, body{std::move(body)}
+    {}
+
+    ExprPtr const cond;
+    StmtPtr const body;
+};
+
+struct Fun : StmtNode {
+    Fun(Exec exec, int slot, std::unique_ptr<FunctionNode> function)
+        : StmtNode{exec}, slot{slot}, function{std::move(function)}
+    {}
+
+    int const slot;
+    std::unique_ptr<FunctionNode> const function;
+};
+
+struct Class : StmtNode {
+    Class(Exec exec, Token const& name, int slot, std::optional<Token> superclassName, ExprPtr superclass,
+          std::vector<std::unique_ptr<FunctionNode>> methods)
+        : StmtNode{exec}, name{name}, slot{slot}, superclassName{std::move(superclassName)},
+          superclass{std::move(superclass)}, methods{std::move(methods)}
+    {}
+
+    Token const name;
+    int const slot;
+    std::optional<Token> const superclassName;
+    ExprPtr const superclass; // may be null
+    std::vector<std::unique_ptr<FunctionNode>> const methods;
+};
+
+template <typename T>
+T const& as(ExprNode const& node)
+{
+    return static_cast<T const&>(node);
+}
+
+template <typename T>
+T const& as(StmtNode const& node)
+{
+    return static_cast<T const&>(node);
+}
+
+void checkNumberOperand(Token const& op, Value const& operand)
+{
+    if (!operand.isNumber()) {
+        throw RuntimeError{op, "Operand must be a number."};
+    }
+}
+
+void checkNumberOperands(Token const& op, Value const& left, Value const& right)
+{
+    if (!left.isNumber() || !right.isNumber()) {
+        throw RuntimeError{op, "Operands must be numbers."};
+    }
+}
+
+Value toValue(double number)
+{
+    return toLoxNumber(number);
+}
+
+Value toValue(bool boolean)
+{
+    return toLoxBoolean(boolean);
+}
+
+// Switches the current environment until the scope is left, one way or
+// another.
+class EnvironmentScope {
+public:
+    EnvironmentScope(Context& context, Environment* environment) : _context{context}, _previous{context.environment}
+    {
+        context.environment = environment;
+    }
+
+    ~EnvironmentScope()
+    {
+        _context.environment = _previous;
+    }
+
+    EnvironmentScope(EnvironmentScope const&) = delete;
+    EnvironmentScope& operator=(EnvironmentScope const&) = delete;
+
+private:
+    Context& _context;
+    Environment* const _previous;
+};
+
+bool executeBlock(std::vector<StmtPtr> const& stmts, Environment* environment, Context& context)
+{
+    // Once we switch to `environment`, the one we return to is referenced only
+    // from here. Rooting the active environment of every block keeps them all.
+    GarbageCollector::RootScope roots{context.gc};
+    roots.add(environment);
+    context.gc->maybeCollect();
+
+    EnvironmentScope scope{context, environment};
+    for (auto const& stmt : stmts) {
+        if ((*stmt)(context)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+LoxFunction* makeFunction(FunctionNode const& function, Environment* closure, Context& context)
+{
+    return context.gc->create<LoxFunction>(context.gc, function.proto, closure);
+}
+
+Value evalConstant(ExprNode const& node, Context& /*context*/)
+{
+    return as<Constant>(node).value;
+}
+
+Value evalLocal(ExprNode const& node, Context& context)
+{
+    auto& variable = as<Variable>(node);
+    return context.environment->getAt(variable.depth, variable.slot);
+}
+
+Value evalGlobal(ExprNode const& node, Context& context)
+{
+    auto& variable = as<Variable>(node);
+    return context.globals->get(variable.slot, variable.name);
+}
+
+Value evalAssignLocal(ExprNode const& node, Context& context)
+{
+    auto& assign = as<Assign>(node);
+    auto value = (*assign.value)(context);
+    context.environment->assignAt(assign.depth, assign.slot, value);
+    return value;
+}
+
+Value evalAssignGlobal(ExprNode const& node, Context& context)
+{
+    auto& assign = as<Assign>(node);
+    auto value = (*assign.value)(context);
+    context.globals->assign(assign.slot, assign.name, value);
+    return value;
+}
+
+// Only the type of the left operand is looked at before the right one is
+// evaluated, so it need not be rooted meanwhile.
+template <typename Op>
+Value evalNumbers(ExprNode const& node, Context& context)
+{
+    auto& binary = as<Binary>(node);
+    auto left = (*binary.left)(context);
+    auto right = (*binary.right)(context);
+    checkNumberOperands(binary.op, left, right);
+    return toValue(Op{}(left.asNumber(), right.asNumber()));
+}
+
+Value evalAdd(ExprNode const& node, Context& context)
+{
+    auto& binary = as<Binary>(node);
+    GarbageCollector::RootScope roots{context.gc};
+    auto left = (*binary.left)(context);
+    roots.add(left.toTraceable());
+    auto right = (*binary.right)(context);
+
+    if (left.isNumber() && right.isNumber()) {
+        return toLoxNumber(left.asNumber() + right.asNumber());
+    }
+    if (left.isObject(LoxObject::Kind::STRING) && right.isObject(LoxObject::Kind::STRING)) {
+        return context.gc->concatenate(static_cast<LoxString&>(*left.asObject()),
+                                       static_cast<LoxString&>(*right.asObject()));
+    }
+    throw RuntimeError(binary.op, "Operands must be two numbers or two strings.");
+}
+
+template <bool isEqual>
+Value evalEquality(ExprNode const& node, Context& context)
+{
+    auto& binary = as<Binary>(node);
+    GarbageCollector::RootScope roots{context.gc};
+    auto left = (*binary.left)(context);
+    roots.add(left.toTraceable());
+    auto right = (*binary.right)(context);
+    return toLoxBoolean(left.equals(right) == isEqual);
+}
+
+Value evalAnd(ExprNode const& node, Context& context)
+{
+    auto& binary = as<Binary>(node);
+    auto left = (*binary.left)(context);
+    if (!left.isTruthy()) {
+        return left;
+    }
+    return (*binary.right)(context);
+}
+
+Value evalOr(ExprNode const& node, Context& context)
+{
+    auto& binary = as<Binary>(node);
+    auto left = (*binary.left)(context);
+    if (left.isTruthy()) {
+        return left;
+    }
+    return (*binary.right)(context);
+}
+
+Value evalNot(ExprNode const& node, Context& context)
+{
+    return toLoxBoolean(!(*as<Unary>(node).right)(context).isTruthy());
+}
+
+Value evalNegate(ExprNode const& node, Context& context)
+{
+    auto& unary = as<Unary>(node);
+    auto right = (*unary.right)(context);
+    checkNumberOperand(unary.op, right);
+    return toLoxNumber(-right.asNumber());
+}
+
+// Calls `function` like LoxFunction does, except that the arguments are
+// evaluated right into the environment of the call.
+Value callFunction(Call const& call, LoxFunction* function, LoxInstance* receiver, Context& context)
+{
+    auto& proto = function->proto();
+    if (!receiver) {
+        receiver = function->receiver();
+    }
+
+    GarbageCollector::RootScope roots{context.gc};
+    auto environment = context.gc->create<Environment>(context.gc, function->closure(), proto.frameSize);
+    roots.add(environment);
+
+    size_t slot = 0;
+    if (receiver) {
+        environment->define(slot++, receiver);
+    }
+    for (auto const& arg : call.args) {
+        environment->define(slot++, (*arg)(context));
+    }
+
+    if (call.args.size() != proto.arity) {
+        throw RuntimeError(call.paren, "Expected " + std::to_string(proto.arity) + " arguments but got " +
+                                           std::to_string(call.args.size()) + ".");
+    }
+
+    auto result = proto.executor(environment, proto.declaration.body);
+    return proto.isInitializer ? receiver : result;
+}
+
+// Calls `callee` with the arguments of `call`, invoking it on `receiver` if
+// that is not null.
+Value callWithArgs(Call const& call, Value const& callee, LoxInstance* receiver, Context& context)
+{
+    GarbageCollector::RootScope roots{context.gc};
+    roots.add(callee.toTraceable());
+    if (receiver) {
+        roots.add(receiver);
+    }
+
+    if (callee.isObject(LoxObject::Kind::FUNCTION)) {
+        return callFunction(call, static_cast<LoxFunction*>(callee.asObject()), receiver, context);
+    }
+    if (callee.isObject(LoxObject::Kind::CLASS)) {
+        auto klass = static_cast<LoxClass*>(callee.asObject());
+        if (auto initializer = klass->findMethod("init")) {
+            auto instance = context.gc->create<LoxInstance>(context.gc, klass);
+            roots.add(instance);
+            return callFunction(call, initializer, instance, context);
+        }
+    }
+
+    std::vector<Value> args;
+    args.reserve(call.args.size());
+    for (auto const& arg : call.args) {
+        args.push_back((*arg)(context));
+        roots.add(args.back().toTraceable());
+    }
+
+    if (!callee.isObject() || !callee.asObject()->isCallable()) {
+        throw RuntimeError(call.paren, "Can only call functions and classes.");
+    }
+    auto callable = static_cast<LoxCallable*>(callee.asObject());
+
+    if (args.size() != callable->arity()) {
+        throw RuntimeError(call.paren, "Expected " + std::to_string(callable->arity()) + " arguments but got " +
+                                           std::to_string(args.size()) + ".");
+    }
+
+    if (receiver) {
+        return static_cast<LoxFunction*>(callable)->invoke(receiver, args);
+    }
+    return callable->call(args);
+}
+
+Value evalCall(ExprNode const& node, Context& context)
+{
+    auto& call = as<Call>(node);
+    return callWithArgs(call, (*call.callee)(context), nullptr, context);
+}
+
+Value evalGet(ExprNode const& node, Context& context)
+{
+    auto& get = as<Property>(node);
+    auto object = (*get.object)(context);
+    if (!object.isObject(LoxObject::Kind::INSTANCE)) {
+        throw RuntimeError(get.name, "Only instances have properties.");
+    }
+    return static_cast<LoxInstance*>(object.asObject())->get(get.name, get.cache, context.cacheStats);
+}
+
+Value evalSet(ExprNode const& node, Context& context)
+{
+    auto& set = as<Property>(node);
+    GarbageCollector::RootScope roots{context.gc};
+    auto object = (*set.object)(context);
+    if (!object.isObject(LoxObject::Kind::INSTANCE)) {
+        throw RuntimeError(set.name, "Only instances have fields.");
+    }
+    roots.add(object.toTraceable());
+
+    auto value = (*set.value)(context);
+    static_cast<LoxInstance*>(object.asObject())->set(set.name, value, set.cache, context.cacheStats);
+    return value;
+}
+
+// Finds the method `super` refers to and the instance to call it on.
+LoxFunction* findSuperMethod(Super const& super, LoxInstance*& instance, Context& context)
+{
+    // "super" occupies the first slot of its own scope, which encloses the
+    // scope of the method with "this" in its first slot.
+    auto& superclass = context.environment->getAt(super.depth, 0);
+    auto& object = context.environment->getAt(super.depth - 1, 0);
+    LOX_ASSERT(superclass.isObject(LoxObject::Kind::CLASS) && object.isObject(LoxObject::Kind::INSTANCE));
+
+    auto method = static_cast<LoxClass&>(*superclass.asObject()).findMethod(super.method.lexeme);
+    if (!method) {
+        throw RuntimeError(super.method, "Undefined property '" + super.method.lexeme + "'.");
+    }
+    instance = static_cast<LoxInstance*>(object.asObject());
+    return method;
+}
+
+Value evalSuper(ExprNode const& node, Context& context)
+{
+    LoxInstance* instance;
+    auto method = findSuperMethod(as<Super>(node), instance, context);
+    return method->bind(instance);
+}
+
+// Calls of methods invoke them on their instance rather than binding them to
+// it first.
+Value evalInvoke(ExprNode const& node, Context& context)
+{
+    auto& call = as<Call>(node);
+    auto& get = as<Property>(*call.callee);
+    auto object = (*get.object)(context);
+    if (!object.isObject(LoxObject::Kind::INSTANCE)) {
+        throw RuntimeError(get.name, "Only instances have properties.");
+    }
+
+    auto instance = static_cast<LoxInstance*>(object.asObject());
+    Value field;
+    if (auto method = instance->getMethod(get.name, get.cache, context.cacheStats, field)) {
+        return callWithArgs(call, method, instance, context);
+    }
+    return callWithArgs(call, field, nullptr, context);
+}
+
+Value evalInvokeSuper(ExprNode const& node, Context& context)
+{
+    auto& call = as<Call>(node);
+    LoxInstance* instance;
+    auto method = findSuperMethod(as<Super>(*call.callee), instance, context);
+    return callWithArgs(call, method, instance, context);
+}
+
+bool execExpression(StmtNode const& node, Context& context)
+{
+    (*as<Expression>(node).expr)(context);
+    return false;
+}
+
+bool execPrint(StmtNode const& node, Context& context)
+{
+    std::cout << (*as<Expression>(node).expr)(context).toString() << '\n';
+    return false;
+}
+
+bool execReturn(StmtNode const& node, Context& context)
+{
+    context.returnValue = (*as<Expression>(node).expr)(context);
+    return true;
+}
+
+bool execVar(StmtNode const& node, Context& context)
+{
+    auto& var = as<Var>(node);
+    context.environment->define(var.slot, (*var.initializer)(context));
+    return false;
+}
+
+bool execBlock(StmtNode const& node, Context& context)
+{
+    auto blockEnv = context.gc->create<Environment>(context.gc, context.environment);
+    return executeBlock(as<Block>(node).stmts, blockEnv, context);
+}
+
+bool execIf(StmtNode const& node, Context& context)
+{
+    auto& stmt = as<If>(node);
+    if ((*stmt.cond)(context).isTruthy()) {
+        return (*stmt.thenBranch)(context);
+    }
+    if (stmt.elseBranch) {
+        return (*stmt.elseBranch)(context);
+    }
+    return false;
+}
+
+bool execWhile(StmtNode const& node, Context& context)
+{
+    auto& stmt = as<While>(node);
+    while ((*stmt.cond)(context).isTruthy()) {
+        if ((*stmt.body)(context)) {
+            return true;
+        }
+        context.gc->maybeCollect();
+    }
+    return false;
+}
+
+bool execFun(StmtNode const& node, Context& context)
+{
+    auto& fun = as<Fun>(node);
+    context.environment->define(fun.slot, makeFunction(*fun.function, context.environment, context));
+    return false;
+}
+
+bool execClass(StmtNode const& node, Context& context)
+{
+    auto& stmt = as<Class>(node);
+
+    LoxClass* superclass = nullptr;
+    if (stmt.superclass) {
+        auto value = (*stmt.superclass)(context);
+        if (!value.isObject(LoxObject::Kind::CLASS)) {
+            throw RuntimeError(*stmt.superclassName, "Superclass must be a class.");
+        }
+        superclass = static_cast<LoxClass*>(value.asObject());
+    }
+
+    context.environment->define(stmt.slot, makeLoxNil());
+
+    auto methodEnvironment = context.environment;
+    if (superclass) {
+        methodEnvironment = context.gc->create<Environment>(context.gc, context.environment);
+        methodEnvironment->define(0, superclass);
+    }
+
+    std::map<std::string, LoxFunction*> methods;
+    for (auto const& method : stmt.methods) {
+        methods.emplace(method->proto.declaration.name.lexeme, makeFunction(*method, methodEnvironment, context));
+    }
+
+    auto klass = context.gc->create<LoxClass>(context.gc, stmt.name.lexeme, superclass, methods);
+    context.environment->assignAt(0, stmt.slot, klass);
+    return false;
+}
+} // namespace
+
+ClosureInterpreter::FunctionNode::FunctionNode(FunStmt const& declaration, bool isInitializer,
+                                               std::vector<StmtPtr> body, Context& context)
+    : body{std::move(body)},
+      proto{declaration, isInitializer, [this, &context](Environment* environment, std::vector<Stmt> const& /*body*/) {
+                if (executeBlock(this->body, environment, context)) {
+                    return context.returnValue;
+                }
+                return makeLoxNil();
+            }}
+{}
+
+ClosureInterpreter::ClosureInterpreter(Lox* lox, GarbageCollector* gc, PropertyCacheStats* cacheStats)
+    : _lox{lox}, _context{new Context{gc, cacheStats, gc->root(), gc->root(), makeLoxNil()}}
+{}
+
+ClosureInterpreter::~ClosureInterpreter() = default;
+
+void ClosureInterpreter::interpret(std::vector<Stmt> const& stmts)
+{
+    auto const first = _program.size();
+    for (auto const& stmt : stmts) {
+        _program.push_back(compile(stmt));
+    }
+
+    try {
+        // The resolver rejects return statements at the top level, so there
+        // is nothing to unwind to.
+        for (auto i = first; i < _program.size(); i++) {
+            (*_program[i])(*_context);
+        }
+    }
+    catch (RuntimeError& error) {
+        _lox->runtimeError(error);
+    }
+}
+
+void ClosureInterpreter::visit(BlockStmt const& stmt)
+{
+    _stmt = std::make_unique<Block>(execBlock, compile(stmt.stmts));
+}
+
+void ClosureInterpreter::visit(ExprStmt const& stmt)
+{
+    _stmt = std::make_unique<Expression>(execExpression, compile(stmt.expr));
+}
+
+void ClosureInterpreter::visit(IfStmt const& stmt)
+{
+    auto cond = compile(stmt.cond);
+    auto thenBranch = compile(stmt.thenBranch);
+    auto elseBranch = stmt.elseBranch ? compile(*stmt.elseBranch) : nullptr;
+    _stmt = std::make_unique<If>(execIf, std::move(cond), std::move(thenBranch), std::move(elseBranch));
+}
+
+void ClosureInterpreter::visit(WhileStmt const& stmt)
+{
+    auto cond = compile(stmt.cond);
+    auto body = compile(stmt.body);
+    _stmt = std::make_unique<While>(execWhile, std::move(cond), std::move(body));
+}
+
+void ClosureInterpreter::visit(ReturnStmt const& stmt)
+{
+    auto value = stmt.value ? compile(*stmt.value) : std::make_unique<Constant>(evalConstant, makeLoxNil());
+    _stmt = std::make_unique<Expression>(execReturn, std::move(value));
+}
+
+void ClosureInterpreter::visit(PrintStmt const& stmt)
+{
+    _stmt = std::make_unique<Expression>(execPrint, compile(stmt.expr));
+}
+
+void ClosureInterpreter::visit(VarStmt const& stmt)
+{
+    auto initializer =
+        stmt.initializer ? compile(*stmt.initializer) : std::make_unique<Constant>(evalConstant, makeLoxNil());
+    _stmt = std::make_unique<Var>(execVar, stmt.slot(), std::move(initializer));
+}
+
+void ClosureInterpreter::visit(FunStmt const& stmt)
+{
+    _stmt = std::make_unique<Fun>(execFun, stmt.slot(), compileFunction(stmt, false));
+}
+
+void ClosureInterpreter::visit(ClassStmt const& stmt)
+{
+    std::optional<Token> superclassName;
+    ExprPtr superclass;
+    if (stmt.superclass) {
+        superclassName.emplace(stmt.superclass->name);
+        superclass = compile(*stmt.superclass);
+    }
+
+    std::vector<std::unique_ptr<FunctionNode>> methods;
+    for (auto method : stmt.methods) {
+        methods.push_back(compileFunction(*method, method->name.lexeme == "init"));
+    }
+
+    _stmt = std::make_unique<Class>(execClass, stmt.name, stmt.slot(), std::move(superclassName),
+                                    std::move(superclass), std::move(methods));
+}
+
+void ClosureInterpreter::visit(AssignExpr const& expr)
+{
+    auto eval = expr.depth() >= 0 ? evalAssignLocal : evalAssignGlobal;
+    _expr = std::make_unique<Assign>(eval, expr.name, expr.depth(), expr.slot(), compile(expr.value));
+}
+
+void ClosureInterpreter::visit(BinaryExpr const& expr)
+{
+    ExprNode::Eval eval = nullptr;
+    switch (expr.op.type) {
+    case Token::GREATER:
+        eval = evalNumbers<std::greater<>>;
+        break;
+    case Token::GREATER_EQUAL:
+        eval = evalNumbers<std::greater_equal<>>;
+        break;
+    case Token::LESS:
+        eval = evalNumbers<std::less<>>;
+        break;
+    case Token::LESS_EQUAL:
+        eval = evalNumbers<std::less_equal<>>;
+        break;
+    case Token::MINUS:
+        eval = evalNumbers<std::minus<>>;
+        break;
+    case Token::PLUS:
+        eval = evalAdd;
+        break;
+    case Token::SLASH:
+        eval = evalNumbers<std::divides<>>;
+        break;
+    case Token::STAR:
+        eval = evalNumbers<std::multiplies<>>;
+        break;
+    case Token::BANG_EQUAL:
+        eval = evalEquality<false>;
+        break;
+    case Token::EQUAL_EQUAL:
+        eval = evalEquality<true>;
+        break;
+    default:
+        LOX_ASSERT(false); // Unreachable.
+        break;
+    }
+
+    auto left = compile(expr.left);
+    auto right = compile(expr.right);
+    _expr = std::make_unique<Binary>(eval, expr.op, std::move(left), std::move(right));
+}
+
+void ClosureInterpreter::visit(CallExpr const& expr)
+{
+    // The callee of an invocation is only compiled for its parts.
+    auto eval = evalCall;
+    if (expr.callee.toGetExpr()) {
+        eval = evalInvoke;
+    }
+    else if (expr.callee.toSuperExpr()) {
+        eval = evalInvokeSuper;
+    }
+
+    auto callee = compile(expr.callee);
+    std::vector<ExprPtr> args;
+    for (auto const& arg : expr.args) {
+        args.push_back(compile(arg));
+    }
+    _expr = std::make_unique<Call>(eval, expr.paren, std::move(callee), std::move(args));
+}
+
+void ClosureInterpreter::visit(GetExpr const& expr)
+{
+    _expr = std::make_unique<Property>(evalGet, expr.name, compile(expr.object), nullptr);
+}
+
+void ClosureInterpreter::visit(GroupingExpr const& expr)
+{
+    _expr = compile(expr.expr);
+}
+
+void ClosureInterpreter::visit(LiteralExpr const& expr)
+{
+    _expr = std::make_unique<Constant>(evalConstant, expr.value);
+}
+
+void ClosureInterpreter::visit(LogicalExpr const& expr)
+{
+    LOX_ASSERT(expr.op.type == Token::OR || expr.op.type == Token::AND);
+    auto eval = expr.op.type == Token::OR ? evalOr : evalAnd;
+    auto left = compile(expr.left);
+    auto right = compile(expr.right);
+    _expr = std::make_unique<Binary>(eval, expr.op, std::move(left), std::move(right));
+}
+
+void ClosureInterpreter::visit(SetExpr const& expr)
+{
+    auto object = compile(expr.object);
+    auto value = compile(expr.value);
+    _expr = std::make_unique<Property>(evalSet, expr.name, std::move(object), std::move(value));
+}
+
+void ClosureInterpreter::visit(ThisExpr const& expr)
+{
+    _expr = compileVariable(expr.depth(), expr.slot(), expr.keyword);
+}
+
+void ClosureInterpreter::visit(SuperExpr const& expr)
+{
+    LOX_ASSERT(expr.depth() > 0); // Otherwise, we have a scope resolve bug.
+    _expr = std::make_unique<Super>(evalSuper, expr.method, expr.depth());
+}
+
+void ClosureInterpreter::visit(UnaryExpr const& expr)
+{
+    LOX_ASSERT(expr.op.type == Token::BANG || expr.op.type == Token::MINUS);
+    auto eval = expr.op.type == Token::BANG ? evalNot : evalNegate;
+    _expr = std::make_unique<Unary>(eval, expr.op, compile(expr.right));
+}
+
+void ClosureInterpreter::visit(VariableExpr const& expr)
+{
+    _expr = compileVariable(expr.depth(), expr.slot(), expr.name);
+}
+
+ClosureInterpreter::StmtPtr ClosureInterpreter::compile(Stmt const& stmt)
+{
+    stmt.accept(*this);
+    LOX_ASSERT(_stmt);
+    return std::move(_stmt);
+}
+
+ClosureInterpreter::ExprPtr ClosureInterpreter::compile(Expr const& expr)
+{
+    expr.accept(*this);
+    LOX_ASSERT(_expr);
+    return std::move(_expr);
+}
+
+std::vector<ClosureInterpreter::StmtPtr> ClosureInterpreter::compile(std::vector<Stmt> const& stmts)
+{
+    std::vector<StmtPtr> nodes;
+    for (auto const& stmt : stmts) {
+        nodes.push_back(compile(stmt));
+    }
+    return nodes;
+}
+
+std::unique_ptr<ClosureInterpreter::FunctionNode> ClosureInterpreter::compileFunction(FunStmt const& stmt,
+                                                                                      bool isInitializer)
+{
+    return std::make_unique<FunctionNode>(stmt, isInitializer, compile(stmt.body), *_context);
+}
+
+ClosureInterpreter::ExprPtr ClosureInterpreter::compileVariable(int depth, int slot, Token const& name)
+{
+    return std::make_unique<Variable>(depth >= 0 ? evalLocal : evalGlobal, name, depth, slot);
+}
+
+} // namespace cloxx
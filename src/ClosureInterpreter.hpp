@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "ast/Expr.hpp"
+#include "ast/Stmt.hpp"
+
+namespace cloxx {
+
+class Lox;
+class GarbageCollector;
+struct PropertyCacheStats;
+
+// Compiles the resolved AST once into a tree of nodes that each carry a
+// pointer to the function running them, picked for the operator or the kind
+// of variable at hand, along with their children and resolved slots. Running
+// the tree takes no visitor double dispatch and no stack of results, while
+// runtime errors are reported from the same tokens as in the Interpreter.
+class ClosureInterpreter : StmtVisitor, ExprVisitor {
+public:
+    // Property lookups are counted into `cacheStats` unless it is null.
+    ClosureInterpreter(Lox* lox, GarbageCollector* gc, PropertyCacheStats* cacheStats);
+    ~ClosureInterpreter();
+
+    ClosureInterpreter(ClosureInterpreter const&) = delete;
+    ClosureInterpreter& operator=(ClosureInterpreter const&) = delete;
+
+    void interpret(std::vector<Stmt> const& stmts);
+
+    // Compiled code and the state it runs against, defined in the source file
+    struct Context;
+    struct ExprNode;
+    struct StmtNode;
+    struct FunctionNode;
+
+private:
+    using ExprPtr = std::unique_ptr<ExprNode>;
+    using StmtPtr = std::unique_ptr<StmtNode>;
+
+    // StmtVisitor
+    void visit(BlockStmt const& stmt) override;
+    void visit(ExprStmt const& stmt) override;
+    void visit(IfStmt const& stmt) override;
+    void visit(WhileStmt const& stmt) override;
+    void visit(ReturnStmt const& stmt) override;
+    void visit(PrintStmt const& stmt) override;
+    void visit(VarStmt const& stmt) override;
+    void visit(FunStmt const& stmt) override;
+    void visit(ClassStmt const& stmt) override;
+
+    // ExprVisitor
+    void visit(AssignExpr const& expr) override;
+    void visit(BinaryExpr const& expr) override;
+    void visit(CallExpr const& expr) override;
+    void visit(GetExpr const& expr) override;
+    void visit(GroupingExpr const& expr) override;
+    void visit(LiteralExpr const& expr) override;
+    void visit(LogicalExpr const& expr) override;
+    void visit(SetExpr const& expr) override;
+    void visit(ThisExpr const& expr) override;
+    void visit(SuperExpr const& expr) override;
+    void visit(UnaryExpr const& expr) override;
+    void visit(VariableExpr const& expr) override;
+
+    StmtPtr compile(Stmt const& stmt);
+    ExprPtr compile(Expr const& expr);
+    std::vector<StmtPtr> compile(std::vector<Stmt> const& stmts);
+    std::unique_ptr<FunctionNode> compileFunction(FunStmt const& stmt, bool isInitializer);
+    ExprPtr compileVariable(int depth, int slot, Token const& name);
+
+    Lox* const _lox;
+    std::unique_ptr<Context> const _context;
+
+    // Compiled top-level statements. Functions declared in them refer to
+    // their nodes, so they are kept as long as the interpreter is.
+    std::vector<StmtPtr> _program;
+
+    // Result of the last visit
+    StmtPtr _stmt;
+    ExprPtr _expr;
+};
+
+} // namespace cloxx
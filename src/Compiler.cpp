@@ -0,0 +1,508 @@
+#include "Compiler.hpp"
+
+#include <limits>
+
+#include "Assert.hpp"
+
+namespace cloxx {
+
+Compiler::Compiler(Compiler* enclosing) : _enclosing{enclosing}, _chunk{std::make_unique<Chunk>()}
+{}
+
+std::unique_ptr<Chunk> Compiler::compile(std::vector<Stmt> const& stmts)
+{
+    Compiler compiler{nullptr};
+    for (auto const& stmt : stmts) {
+        compiler.compile(stmt);
+    }
+    compiler.emit(OpCode::NIL, 1);
+    compiler.emit(OpCode::RETURN, -1);
+    return std::move(compiler._chunk);
+}
+
+std::unique_ptr<Chunk> Compiler::compileFunction(FunStmt const& stmt, bool isMethod)
+{
+    // Like the interpreter, the body runs in the scope of the parameters.
+    // Initializers are made to return `this` by LoxFunction or the VM.
+    Compiler compiler{this};
+    auto argumentSlots = stmt.params.size() + (isMethod ? 1 : 0);
+    compiler._chunk->argumentSlots = argumentSlots;
+    compiler._locals = argumentSlots;
+
+    // Arguments closures capture are moved to the environment first thing.
+    auto& scope = compiler.beginScope(stmt.captured, argumentSlots);
+    if (scope.environmentSize > 0) {
+        compiler.emit(OpCode::PUSH_SCOPE, 0);
+        compiler.emitU32(scope.environmentSize);
+        for (size_t slot = 0; slot < argumentSlots; slot++) {
+            if (scope.variables[slot].isCaptured) {
+                compiler.emit(OpCode::GET_LOCAL, 1);
+                compiler.emitU32(slot);
+                compiler.emit(OpCode::DEFINE_CAPTURED, -1);
+                compiler.emitU32(scope.variables[slot].slot);
+            }
+        }
+    }
+
+    for (auto const& s : stmt.body) {
+        compiler.compile(s);
+    }
+    compiler.emit(OpCode::NIL, 1);
+    compiler.emit(OpCode::RETURN, -1);
+    compiler.endScope();
+    return std::move(compiler._chunk);
+}
+
+Compiler::Scope& Compiler::beginScope(std::vector<bool> const& captured, size_t argumentSlots)
+{
+    Scope scope{{}, 0, _locals};
+    for (size_t slot = 0; slot < captured.size(); slot++) {
+        if (captured[slot]) {
+            scope.variables.push_back({true, scope.environmentSize++});
+        }
+        else if (slot < argumentSlots) {
+            scope.variables.push_back({false, static_cast<std::uint32_t>(slot)});
+        }
+        else {
+            scope.variables.push_back({false, static_cast<std::uint32_t>(_locals++)});
+        }
+    }
+    _chunk->localSlots = std::max(_chunk->localSlots, _locals);
+
+    _scopes.push_back(std::move(scope));
+    return _scopes.back();
+}
+
+void Compiler::endScope()
+{
+    // Slots of the frame are reused by the scopes that follow.
+    _locals = _scopes.back().enclosingLocals;
+    _scopes.pop_back();
+}
+
+Compiler::Variable Compiler::lookUp(int depth, int slot, size_t& environmentDepth) const
+{
+    environmentDepth = 0;
+    for (auto compiler = this;; compiler = compiler->_enclosing) {
+        LOX_ASSERT(compiler); // Otherwise, we have a scope resolve bug.
+        for (auto scope = compiler->_scopes.rbegin(); scope != compiler->_scopes.rend(); ++scope) {
+            if (depth-- == 0) {
+                auto variable = scope->variables.at(slot);
+                LOX_ASSERT(variable.isCaptured || compiler == this);
+                return variable;
+            }
+            if (scope->environmentSize > 0) {
+                environmentDepth++;
+            }
+        }
+    }
+}
+
+void Compiler::visit(BlockStmt const& stmt)
+{
+    auto hasEnvironment = false;
+    if (auto& scope = beginScope(stmt.captured); scope.environmentSize > 0) {
+        emit(OpCode::PUSH_SCOPE, 0);
+        emitU32(scope.environmentSize);
+        hasEnvironment = true;
+    }
+
+    for (auto const& s : stmt.stmts) {
+        compile(s);
+    }
+
+    if (hasEnvironment) {
+        emit(OpCode::POP_SCOPE, 0);
+    }
+    endScope();
+}
+
+void Compiler::visit(ExprStmt const& stmt)
+{
+    compile(stmt.expr);
+    emit(OpCode::POP, -1);
+}
+
+void Compiler::visit(IfStmt const& stmt)
+{
+    compile(stmt.cond);
+    auto elseJump = emitJump(OpCode::POP_JUMP_IF_FALSE, -1);
+    compile(stmt.thenBranch);
+
+    if (stmt.elseBranch) {
+        auto endJump = emitJump(OpCode::JUMP, 0);
+        patchJump(elseJump);
+        compile(*stmt.elseBranch);
+        patchJump(endJump);
+    }
+    else {
+        patchJump(elseJump);
+    }
+}
+
+void Compiler::visit(WhileStmt const& stmt)
+{
+    auto start = _chunk->code.size();
+    compile(stmt.cond);
+    auto exitJump = emitJump(OpCode::POP_JUMP_IF_FALSE, -1);
+    compile(stmt.body);
+    emitLoop(start);
+    patchJump(exitJump);
+}
+
+void Compiler::visit(ReturnStmt const& stmt)
+{
+    if (stmt.value) {
+        compile(*stmt.value);
+    }
+    else {
+        emit(OpCode::NIL, 1);
+    }
+    emit(OpCode::RETURN, -1);
+}
+
+void Compiler::visit(PrintStmt const& stmt)
+{
+    compile(stmt.expr);
+    emit(OpCode::PRINT, -1);
+}
+
+void Compiler::visit(VarStmt const& stmt)
+{
+    if (stmt.initializer) {
+        compile(*stmt.initializer);
+    }
+    else {
+        emit(OpCode::NIL, 1);
+    }
+    compileDefinition(stmt.depth(), stmt.slot());
+}
+
+void Compiler::visit(FunStmt const& stmt)
+{
+    emit(OpCode::CLOSURE, 1);
+    emitU32(_chunk->functions.size());
+    _chunk->functions.push_back({stmt, false, compileFunction(stmt, false), nullptr});
+    compileDefinition(stmt.depth(), stmt.slot());
+}
+
+void Compiler::visit(ClassStmt const& stmt)
+{
+    ClassInfo info{stmt.name, std::nullopt, {}};
+    if (stmt.superclass) {
+        visit(*stmt.superclass);
+        info.superclass.emplace(stmt.superclass->name);
+
+        // The VM makes an environment with only "super" for the methods.
+        beginScope({true});
+    }
+
+    for (auto method : stmt.methods) {
+        info.methods.push_back(static_cast<std::uint32_t>(_chunk->functions.size()));
+        _chunk->functions.push_back(
+            {*method, method->name.lexeme == "init", compileFunction(*method, true), nullptr});
+    }
+
+    if (stmt.superclass) {
+        endScope();
+    }
+
+    emit(OpCode::CLASS, stmt.superclass ? 0 : 1);
+    emitU32(_chunk->classes.size());
+    _chunk->classes.push_back(std::move(info));
+    compileDefinition(stmt.depth(), stmt.slot());
+}
+
+void Compiler::visit(AssignExpr const& expr)
+{
+    compile(expr.value);
+    compileAssignment(expr.depth(), expr.slot(), expr.name);
+}
+
+void Compiler::visit(BinaryExpr const& expr)
+{
+    compile(expr.left);
+    compile(expr.right);
+
+    switch (expr.op.type) {
+    case Token::BANG_EQUAL:
+        emit(OpCode::NOT_EQUAL, -1);
+        return;
+    case Token::EQUAL_EQUAL:
+        emit(OpCode::EQUAL, -1);
+        return;
+    case Token::GREATER:
+        emit(OpCode::GREATER, -1);
+        break;
+    case Token::GREATER_EQUAL:
+        emit(OpCode::GREATER_EQUAL, -1);
+        break;
+    case Token::LESS:
+        emit(OpCode::LESS, -1);
+        break;
+    case Token::LESS_EQUAL:
+        emit(OpCode::LESS_EQUAL, -1);
+        break;
+    case Token::MINUS:
+        emit(OpCode::SUBTRACT, -1);
+        break;
+    case Token::PLUS:
+        emit(OpCode::ADD, -1);
+        break;
+    case Token::SLASH:
+        emit(OpCode::DIVIDE, -1);
+        break;
+    case Token::STAR:
+        emit(OpCode::MULTIPLY, -1);
+        break;
+    default:
+        LOX_ASSERT(false); // Unreachable.
+        return;
+    }
+    emitToken(expr.op);
+}
+
+void Compiler::visit(CallExpr const& expr)
+{
+    // Methods called right away are pushed along with their instance to be
+    // invoked on it, rather than bound to it first.
+    auto op = OpCode::INVOKE;
+    if (auto get = expr.callee.toGetExpr()) {
+        compile(get->object);
+        emit(OpCode::GET_METHOD, 1);
+        emitToken(get->name);
+        emitCache();
+    }
+    else if (auto super = expr.callee.toSuperExpr()) {
+        LOX_ASSERT(super->depth() > 0); // Otherwise, we have a scope resolve bug.
+        size_t environmentDepth;
+        lookUp(super->depth(), super->slot(), environmentDepth);
+        compileVariable(super->depth() - 1, 0, super->keyword);
+        emit(OpCode::GET_SUPER_METHOD, 1);
+        emitU32(environmentDepth);
+        emitToken(super->method);
+    }
+    else {
+        compile(expr.callee);
+        op = OpCode::CALL;
+    }
+
+    for (auto const& arg : expr.args) {
+        compile(arg);
+    }
+    auto popCount = expr.args.size() + (op == OpCode::INVOKE ? 1 : 0);
+    emit(op, -static_cast<int>(popCount));
+    emitU32(expr.args.size());
+    emitToken(expr.paren);
+}
+
+void Compiler::visit(GetExpr const& expr)
+{
+    compile(expr.object);
+    emit(OpCode::GET_PROPERTY, 0);
+    emitToken(expr.name);
+    emitCache();
+}
+
+void Compiler::visit(GroupingExpr const& expr)
+{
+    compile(expr.expr);
+}
+
+void Compiler::visit(LiteralExpr const& expr)
+{
+    auto& value = expr.value;
+    if (value.isNil()) {
+        emit(OpCode::NIL, 1);
+    }
+    else if (value.isBoolean()) {
+        emit(value.asBoolean() ? OpCode::TRUE : OpCode::FALSE, 1);
+    }
+    else {
+        emit(OpCode::CONSTANT, 1);
+        emitU32(_chunk->constants.size());
+        _chunk->constants.push_back(value);
+    }
+}
+
+void Compiler::visit(LogicalExpr const& expr)
+{
+    compile(expr.left);
+
+    // Short-circuit with the left operand as the result.
+    LOX_ASSERT(expr.op.type == Token::OR || expr.op.type == Token::AND);
+    auto endJump = emitJump(expr.op.type == Token::OR ? OpCode::JUMP_IF_TRUE : OpCode::JUMP_IF_FALSE, 0);
+    emit(OpCode::POP, -1);
+    compile(expr.right);
+    patchJump(endJump);
+}
+
+void Compiler::visit(SetExpr const& expr)
+{
+    // Like the interpreter, fail before evaluating the value if there is no
+    // instance to set the field on.
+    compile(expr.object);
+    emit(OpCode::CHECK_FIELDS, 0);
+    emitToken(expr.name);
+
+    compile(expr.value);
+    emit(OpCode::SET_PROPERTY, -1);
+    emitToken(expr.name);
+    emitCache();
+}
+
+void Compiler::visit(ThisExpr const& expr)
+{
+    compileVariable(expr.depth(), expr.slot(), expr.keyword);
+}
+
+void Compiler::visit(SuperExpr const& expr)
+{
+    // The instance is "this" of the method, in the scope right inside that
+    // of "super".
+    LOX_ASSERT(expr.depth() > 0); // Otherwise, we have a scope resolve bug.
+    size_t environmentDepth;
+    lookUp(expr.depth(), expr.slot(), environmentDepth);
+    compileVariable(expr.depth() - 1, 0, expr.keyword);
+    emit(OpCode::GET_SUPER, 0);
+    emitU32(environmentDepth);
+    emitToken(expr.method);
+}
+
+void Compiler::visit(UnaryExpr const& expr)
+{
+    compile(expr.right);
+    if (expr.op.type == Token::BANG) {
+        emit(OpCode::NOT, 0);
+    }
+    else {
+        LOX_ASSERT(expr.op.type == Token::MINUS);
+        emit(OpCode::NEGATE, 0);
+        emitToken(expr.op);
+    }
+}
+
+void Compiler::visit(VariableExpr const& expr)
+{
+    compileVariable(expr.depth(), expr.slot(), expr.name);
+}
+
+void Compiler::compile(Stmt const& stmt)
+{
+    stmt.accept(*this);
+}
+
+void Compiler::compile(Expr const& expr)
+{
+    expr.accept(*this);
+}
+
+void Compiler::compileVariable(int depth, int slot, Token const& name)
+{
+    if (depth < 0) {
+        emit(OpCode::GET_GLOBAL, 1);
+        emitU32(slot);
+        emitToken(name);
+        return;
+    }
+
+    size_t environmentDepth;
+    auto variable = lookUp(depth, slot, environmentDepth);
+    if (variable.isCaptured) {
+        emit(OpCode::GET_CAPTURED, 1);
+        emitU32(environmentDepth);
+    }
+    else {
+        emit(OpCode::GET_LOCAL, 1);
+    }
+    emitU32(variable.slot);
+}
+
+void Compiler::compileAssignment(int depth, int slot, Token const& name)
+{
+    if (depth < 0) {
+        emit(OpCode::SET_GLOBAL, 0);
+        emitU32(slot);
+        emitToken(name);
+        return;
+    }
+
+    size_t environmentDepth;
+    auto variable = lookUp(depth, slot, environmentDepth);
+    if (variable.isCaptured) {
+        emit(OpCode::SET_CAPTURED, 0);
+        emitU32(environmentDepth);
+    }
+    else {
+        emit(OpCode::SET_LOCAL, 0);
+    }
+    emitU32(variable.slot);
+}
+
+void Compiler::compileDefinition(int depth, int slot)
+{
+    if (depth < 0) {
+        emit(OpCode::DEFINE_GLOBAL, -1);
+        emitU32(slot);
+        return;
+    }
+
+    // Declarations always land in the innermost scope, whose environment is
+    // the current one if it has any.
+    LOX_ASSERT(depth == 0);
+    auto variable = _scopes.back().variables.at(slot);
+    emit(variable.isCaptured ? OpCode::DEFINE_CAPTURED : OpCode::DEFINE_LOCAL, -1);
+    emitU32(variable.slot);
+}
+
+void Compiler::emit(OpCode op, int stackEffect)
+{
+    _chunk->code.push_back(static_cast<std::uint8_t>(op));
+
+    LOX_ASSERT(stackEffect >= 0 || _stackDepth >= static_cast<size_t>(-stackEffect));
+    _stackDepth += stackEffect;
+    _chunk->maxStackDepth = std::max(_chunk->maxStackDepth, _stackDepth);
+}
+
+void Compiler::emitU32(size_t operand)
+{
+    LOX_ASSERT(operand <= std::numeric_limits<std::uint32_t>::max());
+    auto value = static_cast<std::uint32_t>(operand);
+    auto bytes = reinterpret_cast<std::uint8_t const*>(&value);
+    _chunk->code.insert(_chunk->code.end(), bytes, bytes + sizeof(value));
+}
+
+void Compiler::emitToken(Token const& token)
+{
+    emitU32(_chunk->tokens.size());
+    _chunk->tokens.push_back(token);
+}
+
+void Compiler::emitCache()
+{
+    emitU32(_chunk->caches.size());
+    _chunk->caches.emplace_back();
+}
+
+size_t Compiler::emitJump(OpCode op, int stackEffect)
+{
+    emit(op, stackEffect);
+    auto operand = _chunk->code.size();
+    emitU32(0);
+    return operand;
+}
+
+void Compiler::patchJump(size_t operand)
+{
+    // Offsets are relative to the end of the jump instruction.
+    auto offset = static_cast<std::uint32_t>(_chunk->code.size() - operand - sizeof(std::uint32_t));
+    std::memcpy(&_chunk->code[operand], &offset, sizeof(offset));
+}
+
+void Compiler::emitLoop(size_t target)
+{
+    emit(OpCode::LOOP, 0);
+    emitU32(_chunk->code.size() + sizeof(std::uint32_t) - target);
+}
+
+} // namespace cloxx
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "ast/Expr.hpp"
+#include "ast/Stmt.hpp"
+
+#include "Chunk.hpp"
+
+namespace cloxx {
+
+// Compiles resolved statements to bytecode for the VM. Variables that no
+// closure captures get a slot in the frame of their function, the others one
+// in the environment of their scope. Functions and classes are the same as
+// those of the tree-walking Interpreter.
+class Compiler : StmtVisitor, ExprVisitor {
+public:
+    static std::unique_ptr<Chunk> compile(std::vector<Stmt> const& stmts);
+
+private:
+    // Of the function enclosing the one to compile, if any
+    explicit Compiler(Compiler* enclosing);
+
+    // Where a variable lives: a slot of the frame, or of the environment of
+    // its scope if closures capture it
+    struct Variable {
+        bool isCaptured;
+        std::uint32_t slot;
+    };
+
+    struct Scope {
+        // By the slot the resolver assigned
+        std::vector<Variable> variables;
+
+        // Slots of its environment. Scopes with nothing captured have none.
+        std::uint32_t environmentSize;
+
+        // Slots of the frame in use outside of it
+        size_t enclosingLocals;
+    };
+
+    std::unique_ptr<Chunk> compileFunction(FunStmt const& stmt, bool isMethod);
+
+    // The first `argumentSlots` slots of a function scope are those the
+    // arguments are passed in.
+    Scope& beginScope(std::vector<bool> const& captured, size_t argumentSlots = 0);
+    void endScope();
+
+    // Finds the variable the resolver found `depth` scopes up, along with
+    // the number of environments to go up for it if it is captured.
+    Variable lookUp(int depth, int slot, size_t& environmentDepth) const;
+
+    // StmtVisitor
+    void visit(BlockStmt const& stmt) override;
+    void visit(ExprStmt const& stmt) override;
+    void visit(IfStmt const& stmt) override;
+    void visit(WhileStmt const& stmt) override;
+    void visit(ReturnStmt const& stmt) override;
+    void visit(PrintStmt const& stmt) override;
+    void visit(VarStmt const& stmt) override;
+    void visit(FunStmt const& stmt) override;
+    void visit(ClassStmt const& stmt) override;
+
+    // ExprVisitor
+    void visit(AssignExpr const& expr) override;
+    void visit(BinaryExpr const& expr) override;
+    void visit(CallExpr const& expr) override;
+    void visit(GetExpr const& expr) override;
+    void visit(GroupingExpr const& expr) override;
+    void visit(LiteralExpr const& expr) override;
+    void visit(LogicalExpr const& expr) override;
+    void visit(SetExpr const& expr) override;
+    void visit(ThisExpr const& expr) override;
+    void visit(SuperExpr const& expr) override;
+    void visit(UnaryExpr const& expr) override;
+    void visit(VariableExpr const& expr) override;
+
+    void compile(Stmt const& stmt);
+    void compile(Expr const& expr);
+    void compileVariable(int depth, int slot, Token const& name);
+    void compileAssignment(int depth, int slot, Token const& name);
+    void compileDefinition(int depth, int slot);
+
+    // `stackEffect` is how many values the instruction pushes, less the
+    // number it pops.
+    void emit(OpCode op, int stackEffect);
+    void emitU32(size_t operand);
+    void emitToken(Token const& token);
+    void emitCache();
+
+    // Returns where to patch the jump offset once the target is known.
+    size_t emitJump(OpCode op, int stackEffect);
+    void patchJump(size_t operand);
+    void emitLoop(size_t target);
+
+    Compiler* const _enclosing;
+    std::unique_ptr<Chunk> _chunk;
+    std::vector<Scope> _scopes;
+    size_t _locals = 0;
+    size_t _stackDepth = 0;
+};
+
+} // namespace cloxx
@@ -1,73 +1,77 @@
 #include "Environment.hpp"
 
 #include "Assert.hpp"
-#include "LoxObject.hpp"
 #include "RuntimeError.hpp"
 #include "Token.hpp"
 
 namespace cloxx {
 
-Environment::Environment(PrivateCreationTag tag) : Traceable{tag}
-{}
-
-Environment::Environment(PrivateCreationTag tag, std::shared_ptr<Environment> const& enclosing)
-    : Traceable{tag}, _enclosing{enclosing}
-{}
+Environment::Environment(PrivateCreationTag tag, GarbageCollector* gc, Environment* enclosing, size_t slotCount)
+    : Traceable{tag, Kind::ENVIRONMENT}, _gc{gc}, _enclosing{enclosing}
+{
+    _values.reserve(slotCount);
+}
 
-void Environment::define(std::string const& name, std::shared_ptr<LoxObject> const& value)
+void Environment::define(size_t slot, Value const& value)
 {
-    LOX_ASSERT(value);
-    _values[name] = value;
+    auto const capacity = _values.capacity();
+
+    // Slots are mostly defined in order.
+    if (slot == _values.size()) {
+        _values.push_back(value);
+    }
+    else {
+        if (slot > _values.size()) {
+            _values.resize(slot + 1, Value::undefined());
+        }
+        _values[slot] = value;
+    }
+    if (_values.capacity() != capacity) {
+        _gc->grow(this, (_values.capacity() - capacity) * sizeof(Value));
+    }
+    _gc->writeBarrier(this, value.toTraceable());
 }
 
-std::shared_ptr<LoxObject> Environment::get(Token const& name) const
+Value const& Environment::get(size_t slot, Token const& name) const
 {
-    if (auto it = _values.find(name.lexeme); it != _values.end()) {
-        return it->second;
+    if (slot < _values.size() && !_values[slot].isUndefined()) {
+        return _values[slot];
     }
 
     throw RuntimeError{name, "Undefined variable '" + name.lexeme + "'."};
 }
 
-void Environment::assign(Token const& name, std::shared_ptr<LoxObject> const& value)
+void Environment::assign(size_t slot, Token const& name, Value const& value)
 {
-    LOX_ASSERT(value);
-
-    if (auto it = _values.find(name.lexeme); it != _values.end()) {
-        it->second = value;
+    if (slot < _values.size() && !_values[slot].isUndefined()) {
+        _values[slot] = value;
+        _gc->writeBarrier(this, value.toTraceable());
         return;
     }
 
     throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
 }
 
-std::shared_ptr<LoxObject> Environment::getAt(size_t distance, std::string const& name) const
+Value const& Environment::getAt(size_t distance, size_t slot) const
 {
     auto& values = ancestor(distance)->_values;
-    if (auto it = values.find(name); it != values.end()) {
-        return it->second;
-    }
-
-    LOX_ASSERT(false); // If we have reached here, we have a scope resolve bug.
-    return nullptr;
+    LOX_ASSERT(slot < values.size()); // Otherwise, we have a scope resolve bug.
+    return values[slot];
 }
 
-void Environment::assignAt(size_t distance, std::string const& name, std::shared_ptr<LoxObject> const& value)
+void Environment::assignAt(size_t distance, size_t slot, Value const& value)
 {
-    auto& values = ancestor(distance)->_values;
-    if (auto it = values.find(name); it != values.end()) {
-        it->second = value;
-        return;
-    }
-
-    LOX_ASSERT(false); // If we have reached here, we have a scope resolve bug.
+    auto environment = ancestor(distance);
+    LOX_ASSERT(slot < environment->_values.size()); // Otherwise, we have a scope resolve bug.
+    environment->_values[slot] = value;
+    _gc->writeBarrier(environment, value.toTraceable());
 }
 
 Environment const* Environment::ancestor(size_t distance) const
 {
     auto environment = this;
     for (size_t i = 0; i < distance; i++) {
-        environment = environment->_enclosing.get();
+        environment = environment->_enclosing;
         LOX_ASSERT(environment);
     }
     return environment;
@@ -77,7 +81,7 @@ Environment* Environment::ancestor(size_t distance)
 {
     auto environment = this;
     for (size_t i = 0; i < distance; i++) {
-        environment = environment->_enclosing.get();
+        environment = environment->_enclosing;
         LOX_ASSERT(environment);
     }
     return environment;
@@ -89,17 +93,25 @@ void Environment::enumerateTraceables(Traceable::Enumerator const& enumerator)
         enumerator.enumerate(*_enclosing);
     }
 
-    for (auto& [_, value] : _values) {
-        if (auto traceable = dynamic_cast<Traceable*>(value.get())) {
-            enumerator.enumerate(*traceable);
+    for (auto& value : _values) {
+        if (value.isObject()) {
+            enumerator.enumerate(*value.asObject());
         }
     }
 }
 
-void Environment::reclaim()
+std::string Environment::describe(Describer& describer)
 {
-    _enclosing.reset();
-    _values.clear();
+    if (_enclosing) {
+        describer.field("enclosing", *_enclosing);
+    }
+
+    for (size_t slot = 0; slot < _values.size(); slot++) {
+        if (_values[slot].isObject()) {
+            describer.element(slot, *_values[slot].asObject());
+        }
+    }
+    return "Environment";
 }
 
 } // namespace cloxx
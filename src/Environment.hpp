@@ -1,39 +1,52 @@
 #pragma once
 
-#include <map>
-#include <memory>
 #include <string>
+#include <vector>
 
 #include "GC.hpp"
+#include "Value.hpp"
 
 namespace cloxx {
 
-class LoxObject;
 struct Token;
 
 class Environment : public Traceable {
 public:
-    Environment(PrivateCreationTag);
-    Environment(PrivateCreationTag, std::shared_ptr<Environment> const& enclosing);
+    // Room is made for `slotCount` variables up front when that is known.
+    Environment(PrivateCreationTag tag, GarbageCollector* gc, Environment* enclosing = nullptr, size_t slotCount = 0);
 
-    void define(std::string const& name, std::shared_ptr<LoxObject> const& value);
+    // Variables are looked up by the slot assigned by the resolver.
+    void define(size_t slot, Value const& value);
 
-    std::shared_ptr<LoxObject> get(Token const& name) const;
-    void assign(Token const& name, std::shared_ptr<LoxObject> const& value);
+    // Globals may be referenced before they are defined, so accessing an
+    // undefined one is a runtime error rather than a resolve bug.
+    Value const& get(size_t slot, Token const& name) const;
+    void assign(size_t slot, Token const& name, Value const& value);
 
-    std::shared_ptr<LoxObject> getAt(size_t distance, std::string const& name) const;
-    void assignAt(size_t distance, std::string const& name, std::shared_ptr<LoxObject> const& value);
+    Environment* enclosing() const
+    {
+        return _enclosing;
+    }
+
+    Value const& getAt(size_t distance, size_t slot) const;
+    void assignAt(size_t distance, size_t slot, Value const& value);
 
     // GC support
+    size_t payloadSize() const override
+    {
+        return _values.capacity() * sizeof(Value);
+    }
+
     void enumerateTraceables(Traceable::Enumerator const& enumerator) override;
-    void reclaim() override;
+    std::string describe(Describer& describer) override;
 
 private:
     Environment const* ancestor(size_t distance) const;
     Environment* ancestor(size_t distance);
 
-    std::shared_ptr<Environment> _enclosing;
-    std::map<std::string, std::shared_ptr<LoxObject>> _values;
+    GarbageCollector* const _gc;
+    Environment* const _enclosing;
+    std::vector<Value> _values;
 };
 
 } // namespace cloxx
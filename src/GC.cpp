@@ -1,17 +1,39 @@
 #include "GC.hpp"
 
+#include <algorithm>
+#include <limits>
+
 #include "Assert.hpp"
 #include "Environment.hpp"
+#include "LoxObject.hpp"
+#include "ParallelMarker.hpp"
 
 namespace cloxx {
 
+namespace {
+// Bytes to allocate between two slices of incremental marking
+size_t const incrementalMarkStep = 64 * 1024;
+
+// Objects to sweep at a safe point
+size_t const lazySweepBatch = 1024;
+
+void prefetch(void const* address)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+} // namespace
+
 #ifdef CLOXX_GC_DEBUG
 
 namespace {
 size_t traceableInstanceCount = 0;
 }
 
-Traceable::Traceable(PrivateCreationTag)
+Traceable::Traceable(PrivateCreationTag, Kind kind) : _kind{kind}
 {
     traceableInstanceCount++;
 }
@@ -28,76 +50,372 @@ size_t Traceable::instanceCount()
 
 #else
 
-Traceable::Traceable(PrivateCreationTag)
+Traceable::Traceable(PrivateCreationTag, Kind kind) : _kind{kind}
 {}
 
 #endif
 
-GarbageCollector::GarbageCollector()
+GarbageCollector::GarbageCollector(GCConfig const& config)
+    : _config{config}, _nextCollection{config.minHeapSize}
 {
-    _root = create<Environment>();
+    _root = create<Environment>(this);
+
+    if (config.markThreads > 1) {
+        _parallelMarker = std::make_unique<ParallelMarker>(config.markThreads);
+    }
 }
 
 GarbageCollector::~GarbageCollector()
 {
-    _root.reset();
-    collect();
+    // Everything dies with the collector; there is nothing left to trace.
+    for (auto list : {_youngTraceables, _oldTraceables, _unsweptTraceables}) {
+        while (list) {
+            auto next = list->_next;
+            destroy(list);
+            list = next;
+        }
+    }
+}
+
+LoxString* GarbageCollector::intern(std::string value)
+{
+    auto hash = std::hash<std::string>{}(value);
+    if (auto str = _strings.find(value, hash)) {
+        return str;
+    }
+
+    auto str = create<LoxString>(std::move(value), hash);
+    _strings.insert(str);
+    return str;
+}
+
+LoxString* GarbageCollector::concatenate(LoxString const& left, LoxString const& right)
+{
+    return LoxString::concatenate(this, left, right);
+}
+
+void GarbageCollector::pin(Traceable* traceable)
+{
+    LOX_ASSERT(traceable);
+    _pinned.insert(traceable);
+    if (_isMarking && !traceable->isMarked()) {
+        shade(traceable);
+    }
 }
 
-std::shared_ptr<Environment> const& GarbageCollector::root()
+Environment* GarbageCollector::root()
 {
     return _root;
 }
 
-size_t GarbageCollector::collect()
+void GarbageCollector::addRootSet(RootSet* rootSet)
 {
-    size_t collectedCount = 0;
+    _rootSets.push_back(rootSet);
+}
 
-    // Prologue: Collect all traceables
-    std::vector<std::shared_ptr<Traceable>> traceables;
-    for (auto& weakTraceable : _weakTraceables) {
-        if (auto traceable = weakTraceable.lock()) {
-            traceables.push_back(traceable);
-        }
+void GarbageCollector::removeRootSet(RootSet* rootSet)
+{
+    _rootSets.erase(std::find(_rootSets.begin(), _rootSets.end(), rootSet));
+}
+
+void GarbageCollector::enumerateRoots(Traceable::Enumerator const& enumerator)
+{
+    enumerator.enumerate(*_root);
+    for (auto traceable : _pinned) {
+        enumerator.enumerate(*traceable);
+    }
+    enumerateNativeRoots(enumerator);
+}
+
+void GarbageCollector::enumerateNativeRoots(Traceable::Enumerator const& enumerator)
+{
+    for (auto traceable : _roots) {
+        enumerator.enumerate(*traceable);
+    }
+    for (auto rootSet : _rootSets) {
+        rootSet->enumerateRoots(enumerator);
+    }
+}
+
+// Records the time between its construction and destruction as a pause.
+class GarbageCollector::PauseTimer {
+public:
+    explicit PauseTimer(GCStats& stats) : _stats{stats}, _start{Clock::now()}
+    {}
+
+    ~PauseTimer()
+    {
+        _stats.recordPause(Clock::now() - _start);
     }
 
-    // Mark & Sweep - Step 1: Unmark all reachable traceables
-    for (auto& traceable : traceables) {
-        traceable->_isReachable = false;
+    PauseTimer(PauseTimer const&) = delete;
+    PauseTimer& operator=(PauseTimer const&) = delete;
+
+private:
+    GCStats& _stats;
+    Clock::time_point const _start;
+};
+
+// Grays what it is given unless it is marked already or, in a minor
+// collection, old.
+struct GarbageCollector::Shader : Traceable::Enumerator {
+    Shader(GarbageCollector* gc, bool isMinor) : gc{gc}, isMinor{isMinor}
+    {}
+
+    void enumerate(Traceable& traceable) const override
+    {
+        if (!traceable.isMarked() && !(isMinor && traceable._isOld)) {
+            gc->shade(&traceable);
+        }
     }
 
-    // Mark & Sweep - Step 2: Mark all reachable traceables
-    if (_root) {
-        struct Marker : Traceable::Enumerator {
+    GarbageCollector* const gc;
+    bool const isMinor;
+};
+
+size_t GarbageCollector::collect()
+{
+    PauseTimer timer{_stats};
+
+    // Marking relies on every mark having been cleared by the last sweep.
+    finishSweeping();
+
+    // Mark & Sweep - Step 1: Mark all reachable traceables
+    if (_isMarking) {
+        drainGrayStack(Shader{this, false}, Clock::time_point::max());
+    }
+    else if (_parallelMarker) {
+        struct : Traceable::Enumerator {
             void enumerate(Traceable& traceable) const override
             {
-                if (!traceable._isReachable) {
-                    traceable._isReachable = true;
-                    traceable.enumerateTraceables(*this);
-                }
+                roots.push_back(&traceable);
             }
-        };
-        Marker{}.enumerate(*_root);
+            mutable std::vector<Traceable*> roots;
+        } collector;
+        enumerateRoots(collector);
+        _parallelMarker->mark(collector.roots);
+    }
+    else {
+        Shader shader{this, false};
+        enumerateRoots(shader);
+        drainGrayStack(shader, Clock::time_point::max());
     }
 
-    // Mark & Sweep - Step 3: Reclaim unreachable traceables
-    for (auto& traceable : traceables) {
-        if (!traceable->_isReachable) {
-            traceable->reclaim();
-            traceable.reset();
-            collectedCount += 1;
+    // Mark & Sweep - Step 2: Free unmarked traceables
+    return finishCollection();
+}
+
+void GarbageCollector::startMarking()
+{
+    LOX_ASSERT(!_isMarking && _grayStack.empty());
+
+    PauseTimer timer{_stats};
+    finishSweeping();
+    _isMarking = true;
+    _lastMarkStep = _bytesAllocated;
+    enumerateRoots(Shader{this, false});
+    markSlice();
+}
+
+void GarbageCollector::markIncrementally()
+{
+    PauseTimer timer{_stats};
+    markSlice();
+}
+
+void GarbageCollector::markSlice()
+{
+    // Objects allocated while marking are gray, so a slice that traced less
+    // than was allocated since the previous one would fall behind for good.
+    // Trace twice as much, even if that takes longer than the budget.
+    auto const allocated = _bytesAllocated - _lastMarkStep;
+    _lastMarkStep = _bytesAllocated;
+    if (drainGrayStack(Shader{this, false}, Clock::now() + _config.pauseBudget, 2 * allocated)) {
+        finishCollection();
+    }
+    else {
+        _nextMarkStep = _bytesAllocated + incrementalMarkStep;
+    }
+}
+
+
+bool GarbageCollector::drainGrayStack(Shader const& shader, Clock::time_point deadline, size_t minimumBytes)
+{
+    // Reading the clock costs more than tracing an object, so only do it
+    // every now and then.
+    size_t tracedCount = 0;
+    size_t tracedBytes = 0;
+    while (!_grayStack.empty()) {
+        auto traceable = _grayStack.back();
+        _grayStack.pop_back();
+
+        // Get the next object on its way to the cache while we trace this one.
+        if (!_grayStack.empty()) {
+            prefetch(_grayStack.back());
+        }
+        traceable->enumerateTraceables(shader);
+
+        if (tracedBytes < minimumBytes) {
+            tracedBytes += traceable->allocationSize();
+        }
+        else if (++tracedCount % 256 == 0 && Clock::now() >= deadline) {
+            return false;
         }
     }
+    return true;
+}
+
+size_t GarbageCollector::finishCollection()
+{
+    if (_isMarking) {
+        // Unlike heap objects, native roots are not guarded by the write
+        // barrier and may have changed since marking started.
+        Shader shader{this, false};
+        enumerateNativeRoots(shader);
+        drainGrayStack(shader, Clock::time_point::max());
+        _isMarking = false;
+    }
+    _stats.fullCollections++;
+
+    // The string table is weak. Drop the entries of strings nobody refers to.
+    _strings.removeIf([](LoxString* str) { return !str->isMarked(); });
+
+    // Survivors are promoted, so no old object will refer to a young one.
+    forgetRemembered();
+
+    // Most of the heap is swept lazily, a batch at every safe point, so that
+    // execution resumes right after marking. The young generation is small
+    // and its survivors must be promoted before anything is allocated, so it
+    // is swept right away.
+    LOX_ASSERT(!_unsweptTraceables);
+    size_t collectedCount = 0;
+    if (_config.nurserySize > 0) {
+        _unsweptTraceables = _oldTraceables;
+        _oldTraceables = nullptr;
+        collectedCount = sweepYoung();
+    }
+    else {
+        LOX_ASSERT(!_oldTraceables);
+        _unsweptTraceables = _youngTraceables;
+        _youngTraceables = nullptr;
+    }
+
+    // We don't know how much survived until sweeping is done, unless there
+    // is nothing to sweep.
+    if (_unsweptTraceables) {
+        _nextCollection = std::numeric_limits<size_t>::max();
+    }
+    else {
+        scheduleCollection();
+    }
+
+    return collectedCount;
+}
+
+size_t GarbageCollector::collectYoung()
+{
+    PauseTimer timer{_stats};
+    _stats.minorCollections++;
+
+    // Old objects are assumed to be alive. The ones that may refer to young
+    // objects were recorded by the write barrier.
+    Shader shader{this, true};
+    enumerateRoots(shader);
+    for (auto traceable : _remembered) {
+        traceable->enumerateTraceables(shader);
+    }
+    drainGrayStack(shader, Clock::time_point::max());
 
-    // Epilogue: Rearrange _weakTraceables
-    _weakTraceables.clear();
-    for (auto& traceable : traceables) {
-        if (traceable) {
-            _weakTraceables.push_back(traceable);
+    _strings.removeIf([](LoxString* str) { return !str->_isOld && !str->isMarked(); });
+
+    forgetRemembered();
+    return sweepYoung();
+}
+
+size_t GarbageCollector::sweepYoung()
+{
+    size_t collectedCount = 0;
+
+    auto traceable = _youngTraceables;
+    _youngTraceables = nullptr;
+    while (traceable) {
+        auto next = traceable->_next;
+        if (traceable->isMarked()) {
+            traceable->setMarked(false);
+            traceable->_isOld = true;
+            _stats.recordSurvivor(traceable->allocationSize());
+            traceable->_next = _oldTraceables;
+            _oldTraceables = traceable;
+            _youngBytes -= traceable->allocationSize();
         }
+        else {
+            destroy(traceable);
+            collectedCount += 1;
+        }
+        traceable = next;
     }
 
     return collectedCount;
 }
 
+void GarbageCollector::sweepLazily()
+{
+    PauseTimer timer{_stats};
+    sweepUnswept(lazySweepBatch);
+}
+
+void GarbageCollector::finishSweeping()
+{
+    sweepUnswept(std::numeric_limits<size_t>::max());
+}
+
+void GarbageCollector::sweepUnswept(size_t count)
+{
+    for (; _unsweptTraceables && count > 0; count--) {
+        auto traceable = _unsweptTraceables;
+        _unsweptTraceables = traceable->_next;
+        if (traceable->isMarked()) {
+            traceable->setMarked(false);
+            _stats.recordSurvivor(traceable->allocationSize());
+            auto& list = traceable->_isOld ? _oldTraceables : _youngTraceables;
+            traceable->_next = list;
+            list = traceable;
+        }
+        else {
+            destroy(traceable);
+        }
+    }
+
+    if (!_unsweptTraceables) {
+        scheduleCollection();
+    }
+}
+
+void GarbageCollector::scheduleCollection()
+{
+    auto const threshold = static_cast<size_t>(_bytesAllocated * _config.heapGrowthFactor);
+    _nextCollection = std::max(threshold, _config.minHeapSize);
+}
+
+void GarbageCollector::destroy(Traceable* traceable)
+{
+    auto const size = traceable->allocationSize();
+    _bytesAllocated -= size;
+    if (!traceable->_isOld) {
+        _youngBytes -= size;
+    }
+    _stats.recordFree(traceable->kind(), size);
+    auto const objectSize = traceable->_size;
+    traceable->~Traceable();
+    _allocator.deallocate(traceable, objectSize);
+}
+
+void GarbageCollector::forgetRemembered()
+{
+    for (auto traceable : _remembered) {
+        traceable->_isRemembered = false;
+    }
+    _remembered.clear();
+}
+
 } // namespace cloxx
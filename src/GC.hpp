@@ -1,13 +1,34 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
 #include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "Assert.hpp"
+#include "Shape.hpp"
+#include "SlabAllocator.hpp"
+#include "StringTable.hpp"
+
 namespace cloxx {
 
 class Environment;
 class GarbageCollector;
+class LoxString;
+class ParallelMarker;
 
+// Every object managed by GarbageCollector starts with this header. The
+// collector threads all objects it owns into an intrusive singly linked list
+// through `_next` and keeps the mark bit here, so it needs no side tables.
 class Traceable {
 public:
     class PrivateCreationTag {
@@ -16,7 +37,23 @@ public:
         PrivateCreationTag(){};
     };
 
-    Traceable(PrivateCreationTag);
+    // Concrete type of the object, set at construction. Prefer switching on it
+    // over dynamic_cast on hot paths.
+    enum class Kind : unsigned char {
+        ENVIRONMENT,
+        STRING,
+        NATIVE_FUNCTION,
+        FUNCTION,
+        CLASS,
+        INSTANCE,
+    };
+
+    static constexpr size_t kindCount = static_cast<size_t>(Kind::INSTANCE) + 1;
+
+    Traceable(PrivateCreationTag, Kind kind);
+
+    Traceable(Traceable const&) = delete;
+    Traceable& operator=(Traceable const&) = delete;
 
 #ifdef CLOXX_GC_DEBUG
     virtual ~Traceable();
@@ -25,38 +62,405 @@ public:
     virtual ~Traceable() = default;
 #endif
 
+    Kind kind() const
+    {
+        return _kind;
+    }
+
     struct Enumerator {
         virtual void enumerate(Traceable& traceable) const = 0;
     };
 
     virtual void enumerateTraceables(Enumerator const& enumerator) = 0;
-    virtual void reclaim() = 0;
+
+    // Like Enumerator, but with the name of the field or the index of the
+    // slot that holds each reference.
+    struct Describer {
+        virtual void field(std::string_view name, Traceable& traceable) = 0;
+        virtual void element(size_t index, Traceable& traceable) = 0;
+    };
+
+    // Returns a name for the object, e.g. its class name, and describes its
+    // references. Only used by tools such as heap snapshots, never while
+    // collecting.
+    virtual std::string describe(Describer& describer) = 0;
+
+    // Bytes the object holds outside the heap, such as the characters of a
+    // string, which count towards the heap size. When it changes after the
+    // object was created, the object must report it to GarbageCollector::grow.
+    virtual size_t payloadSize() const
+    {
+        return 0;
+    }
+
+    // Bytes the collector accounts for the object
+    size_t allocationSize() const
+    {
+        return _size + payloadSize();
+    }
 
 private:
     friend class GarbageCollector;
-    bool _isReachable;
+    friend class ParallelMarker;
+
+    bool isMarked() const
+    {
+        return _isMarked.load(std::memory_order_relaxed);
+    }
+
+    void setMarked(bool isMarked)
+    {
+        _isMarked.store(isMarked, std::memory_order_relaxed);
+    }
+
+    // Returns true if this call marked the traceable. Safe against other
+    // threads marking it at the same time.
+    bool tryMark()
+    {
+        return !isMarked() && !_isMarked.exchange(true, std::memory_order_relaxed);
+    }
+
+    Traceable* _next = nullptr;
+    Kind const _kind;
+    std::atomic<bool> _isMarked{false};
+    bool _isOld = false;
+    bool _isRemembered = false;
+    std::uint32_t _size = 0;
+};
+
+// What the collector has done so far, for sizing the heap and tuning the
+// collector.
+struct GCStats {
+    using Clock = std::chrono::steady_clock;
+
+    struct Tally {
+        size_t objects = 0;
+        size_t bytes = 0;
+    };
+
+    GCStats() : startTime{Clock::now()}
+    {}
+
+    void recordAllocation(Traceable::Kind kind, size_t size, size_t heapBytes)
+    {
+        allocated.objects++;
+        allocated.bytes += size;
+        live[static_cast<size_t>(kind)].objects++;
+        live[static_cast<size_t>(kind)].bytes += size;
+        peakHeapBytes = std::max(peakHeapBytes, heapBytes);
+    }
+
+    void recordGrowth(Traceable::Kind kind, size_t size, size_t heapBytes)
+    {
+        allocated.bytes += size;
+        live[static_cast<size_t>(kind)].bytes += size;
+        peakHeapBytes = std::max(peakHeapBytes, heapBytes);
+    }
+
+    void recordFree(Traceable::Kind kind, size_t size)
+    {
+        freed.objects++;
+        freed.bytes += size;
+        live[static_cast<size_t>(kind)].objects--;
+        live[static_cast<size_t>(kind)].bytes -= size;
+    }
+
+    void recordSurvivor(size_t size)
+    {
+        marked.objects++;
+        marked.bytes += size;
+    }
+
+    void recordPause(Clock::duration pause);
+
+    enum class Format {
+        NONE,
+        TEXT,
+        JSON,
+    };
+
+    void print(std::ostream& os, Format format) const;
+
+    Clock::time_point const startTime;
+
+    size_t fullCollections = 0;
+    size_t minorCollections = 0;
+
+    // Every time the program is stopped for the collector: a whole
+    // collection, a slice of incremental marking or a batch of lazy sweeping.
+    // Bucket 0 counts pauses under 1us, bucket i those under 2^i us, and the
+    // last one all the longer ones.
+    static constexpr size_t pauseBucketCount = 21;
+    std::array<size_t, pauseBucketCount> pauseHistogram{};
+    Clock::duration totalPause{0};
+    Clock::duration maxPause{0};
+
+    Tally allocated;
+    Tally marked;
+    Tally freed;
+
+    // Objects in the heap per kind, including garbage not collected yet
+    std::array<Tally, Traceable::kindCount> live{};
+    size_t peakHeapBytes = 0;
+
+private:
+    void printText(std::ostream& os) const;
+    void printJson(std::ostream& os) const;
+};
+
+struct GCConfig {
+    // The next collection is triggered once the heap has grown to this factor
+    // of what survived the previous one...
+    double heapGrowthFactor = 2.0;
+
+    // ...but never before this many bytes are allocated.
+    size_t minHeapSize = 4 * 1024 * 1024;
+
+    // New objects are allocated in a nursery that is collected on its own
+    // whenever this many bytes were allocated in it. Survivors are promoted to
+    // the old generation, which is only traced by full collections. 0 turns
+    // generational collection off.
+    size_t nurserySize = 1024 * 1024;
+
+    // When non-zero, full collections mark incrementally in slices of about
+    // this long, interleaved with execution, instead of stopping the world for
+    // the whole mark phase.
+    std::chrono::microseconds pauseBudget{0};
+
+    // Number of threads that mark the heap during a stop-the-world full
+    // collection.
+    size_t markThreads = 1;
+
+    // Statistics to print to stderr when the program is done.
+    GCStats::Format stats = GCStats::Format::NONE;
+
+    // File to write a heap snapshot to when the program is done, if any.
+    std::string heapSnapshotPath;
 };
 
 class GarbageCollector {
 public:
-    GarbageCollector();
+    explicit GarbageCollector(GCConfig const& config = {});
     ~GarbageCollector();
 
+    GarbageCollector(GarbageCollector const&) = delete;
+    GarbageCollector& operator=(GarbageCollector const&) = delete;
+
     template <typename T, typename... Args>
-    std::shared_ptr<T> create(Args&&... args)
+    T* create(Args&&... args)
     {
-        auto traceable = std::make_shared<T>(Traceable::PrivateCreationTag{}, std::forward<Args>(args)...);
-        _weakTraceables.push_back(traceable);
+        auto memory = _allocator.allocate(sizeof(T));
+        T* traceable;
+        try {
+            traceable = new (memory) T(Traceable::PrivateCreationTag{}, std::forward<Args>(args)...);
+        }
+        catch (...) {
+            _allocator.deallocate(memory, sizeof(T));
+            throw;
+        }
+        LOX_ASSERT(static_cast<Traceable*>(traceable) == memory);
+
+        traceable->_next = _youngTraceables;
+        traceable->_size = sizeof(T);
+        _youngTraceables = traceable;
+
+        // T is known here, so the payload needs no virtual call.
+        auto const size = sizeof(T) + traceable->T::payloadSize();
+        _bytesAllocated += size;
+        _youngBytes += size;
+        _stats.recordAllocation(traceable->kind(), size, _bytesAllocated);
+        if (_isMarking) {
+            // Allocate gray so that whatever the new object refers to is
+            // marked as well.
+            shade(traceable);
+        }
         return traceable;
     }
 
-    std::shared_ptr<Environment> const& root();
+    // Must be called when the payload of `traceable` grows by `size` bytes.
+    void grow(Traceable* traceable, size_t size)
+    {
+        _bytesAllocated += size;
+        if (!traceable->_isOld) {
+            _youngBytes += size;
+        }
+        _stats.recordGrowth(traceable->kind(), size, _bytesAllocated);
+    }
+
+    // Must be called whenever a reference to `target` is stored in `owner`
+    // after `owner` was created, so that minor collections can find young
+    // objects that only old ones refer to, and so that incremental marking
+    // never leaves a marked object referring to an unmarked one.
+    void writeBarrier(Traceable* owner, Traceable* target)
+    {
+        if (!target) {
+            return;
+        }
+        if (owner->_isOld && !target->_isOld && !owner->_isRemembered) {
+            owner->_isRemembered = true;
+            _remembered.push_back(owner);
+        }
+        if (_isMarking && owner->isMarked() && !target->isMarked()) {
+            shade(target);
+        }
+    }
+
+    // Keeps the traceables added to it alive until it goes out of scope. Native
+    // code must use it for objects only its locals refer to across a safe point.
+    class RootScope {
+    public:
+        explicit RootScope(GarbageCollector* gc) : _gc{gc}, _height{gc->_roots.size()}
+        {}
+
+        ~RootScope()
+        {
+            _gc->_roots.resize(_height);
+        }
+
+        RootScope(RootScope const&) = delete;
+        RootScope& operator=(RootScope const&) = delete;
+
+        void add(Traceable* traceable)
+        {
+            if (traceable) {
+                _gc->_roots.push_back(traceable);
+            }
+        }
+
+    private:
+        GarbageCollector* const _gc;
+        size_t const _height;
+    };
+
+    // Native structures that refer to many objects across safe points, such as
+    // the value stack of the VM, register themselves as root sets instead of
+    // adding every object to a RootScope.
+    struct RootSet {
+        virtual void enumerateRoots(Traceable::Enumerator const& enumerator) = 0;
+    };
+
+    void addRootSet(RootSet* rootSet);
+    void removeRootSet(RootSet* rootSet);
+
+    LoxString* intern(std::string value);
+    LoxString* concatenate(LoxString const& left, LoxString const& right);
+
+    // Pinned objects are treated as roots. They are used for constants that
+    // are referenced from outside the heap, e.g. string literals in the AST.
+    void pin(Traceable* traceable);
+
+    Environment* root();
+
+    // Shape of new instances, which have no fields yet
+    Shape* emptyShape()
+    {
+        return &_emptyShape;
+    }
+
+    // Enumerates everything the collector treats as a root.
+    void enumerateRoots(Traceable::Enumerator const& enumerator);
+
+    // Safe point: collects if enough has been allocated since the last cycle.
+    // Every object referenced only from native code must be rooted by then.
+    void maybeCollect()
+    {
+        if (_unsweptTraceables) {
+            sweepLazily();
+        }
+
+        if (_isMarking) {
+            if (_bytesAllocated >= _nextMarkStep) {
+                markIncrementally();
+            }
+        }
+        else if (_bytesAllocated >= _nextCollection) {
+            if (_config.pauseBudget.count() > 0) {
+                startMarking();
+            }
+            else {
+                collect();
+            }
+        }
+        else if (_config.nurserySize > 0 && _youngBytes >= _config.nurserySize) {
+            collectYoung();
+        }
+    }
 
+    // Full collection. Finishes the incremental marking in progress, if any.
+    // Returns the number of objects freed right away; the rest of the garbage
+    // is swept lazily at the following safe points.
     size_t collect();
 
+    // Minor collection: traces and frees young objects only.
+    size_t collectYoung();
+
+    GCStats const& stats() const
+    {
+        return _stats;
+    }
+
 private:
-    std::shared_ptr<Environment> _root;
-    std::vector<std::weak_ptr<Traceable>> _weakTraceables;
+    void shade(Traceable* traceable)
+    {
+        traceable->setMarked(true);
+        _grayStack.push_back(traceable);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    struct Shader;
+    class PauseTimer;
+
+    void startMarking();
+    void markIncrementally();
+    void markSlice();
+    void enumerateNativeRoots(Traceable::Enumerator const& enumerator);
+
+    // Traces at least `minimumBytes` before looking at the deadline. Returns
+    // false if the deadline passed before the gray stack ran out.
+    bool drainGrayStack(Shader const& shader, Clock::time_point deadline, size_t minimumBytes = 0);
+    size_t finishCollection();
+
+    size_t sweepYoung();
+    void sweepLazily();
+    void finishSweeping();
+    void sweepUnswept(size_t count);
+
+    // Sets the heap size for the next full collection from what survived.
+    void scheduleCollection();
+    void destroy(Traceable* traceable);
+    void forgetRemembered();
+
+    GCConfig const _config;
+    SlabAllocator _allocator;
+    Environment* _root = nullptr;
+    Traceable* _youngTraceables = nullptr;
+    Traceable* _oldTraceables = nullptr;
+    Traceable* _unsweptTraceables = nullptr;
+    std::unordered_set<Traceable*> _pinned;
+    std::vector<Traceable*> _roots;
+    std::vector<RootSet*> _rootSets;
+    std::vector<Traceable*> _remembered;
+    StringTable _strings;
+    Shape _emptyShape;
+
+    // Gray objects are marked but their references are yet to be traced.
+    // Marking drains the stack instead of recursing, so it doesn't run out of
+    // native stack on long chains of objects.
+    std::vector<Traceable*> _grayStack;
+
+    // Marks full collections with more than one thread, if configured to
+    std::unique_ptr<ParallelMarker> _parallelMarker;
+
+    // Incremental marking
+    bool _isMarking = false;
+    size_t _nextMarkStep = 0;
+    size_t _lastMarkStep = 0;
+
+    size_t _bytesAllocated = 0;
+    size_t _youngBytes = 0;
+    size_t _nextCollection;
+
+    GCStats _stats;
 };
 
 } // namespace cloxx
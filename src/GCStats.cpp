@@ -0,0 +1,163 @@
+#include "GC.hpp"
+
+#include <iomanip>
+#include <ostream>
+
+namespace cloxx {
+
+namespace {
+char const* kindName(size_t kind)
+{
+    switch (static_cast<Traceable::Kind>(kind)) {
+    case Traceable::Kind::ENVIRONMENT:
+        return "Environment";
+    case Traceable::Kind::STRING:
+        return "LoxString";
+    case Traceable::Kind::NATIVE_FUNCTION:
+        return "LoxNativeFunction";
+    case Traceable::Kind::FUNCTION:
+        return "LoxFunction";
+    case Traceable::Kind::CLASS:
+        return "LoxClass";
+    case Traceable::Kind::INSTANCE:
+        return "LoxInstance";
+    }
+    return "";
+}
+
+double toMicros(GCStats::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+double toSeconds(GCStats::Clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+// Upper bound of the pause histogram bucket in microseconds; 0 for the last,
+// unbounded one.
+size_t bucketLimit(size_t bucket)
+{
+    return bucket + 1 < GCStats::pauseBucketCount ? size_t{1} << bucket : 0;
+}
+} // namespace
+
+void GCStats::recordPause(Clock::duration pause)
+{
+    auto micros = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(pause).count());
+    size_t bucket = 0;
+    while (bucket + 1 < pauseBucketCount && micros >= bucketLimit(bucket)) {
+        bucket++;
+    }
+    pauseHistogram[bucket]++;
+    totalPause += pause;
+    maxPause = std::max(maxPause, pause);
+}
+
+void GCStats::print(std::ostream& os, Format format) const
+{
+    switch (format) {
+    case Format::NONE:
+        break;
+    case Format::TEXT:
+        printText(os);
+        break;
+    case Format::JSON:
+        printJson(os);
+        break;
+    }
+}
+
+void GCStats::printText(std::ostream& os) const
+{
+    auto const elapsed = toSeconds(Clock::now() - startTime);
+    size_t pauseCount = 0;
+    for (auto count : pauseHistogram) {
+        pauseCount += count;
+    }
+
+    auto tally = [&os](char const* name, Tally const& tally) {
+        os << "  " << std::left << std::setw(20) << name << std::right << std::setw(12) << tally.objects
+           << " objects" << std::setw(14) << tally.bytes << " bytes\n";
+    };
+
+    os << std::fixed << std::setprecision(3);
+    os << "GC statistics:\n";
+    os << "  run time            " << std::setw(12) << elapsed << " s\n";
+    os << "  collections         " << std::setw(12) << fullCollections << " full" << std::setw(14)
+       << minorCollections << " minor\n";
+    os << "  pauses              " << std::setw(12) << pauseCount << " total " << toMicros(totalPause)
+       << " us, max " << toMicros(maxPause) << " us\n";
+    tally("allocated", allocated);
+    tally("marked", marked);
+    tally("freed", freed);
+    os << "  allocation rate     " << std::setw(12) << (elapsed > 0 ? allocated.bytes / elapsed : 0.0)
+       << " bytes/s\n";
+    os << "  peak heap           " << std::setw(12) << peakHeapBytes << " bytes\n";
+
+    os << "Live objects:\n";
+    for (size_t kind = 0; kind < live.size(); kind++) {
+        tally(kindName(kind), live[kind]);
+    }
+
+    os << "Pause histogram:\n";
+    for (size_t bucket = 0; bucket < pauseHistogram.size(); bucket++) {
+        if (pauseHistogram[bucket] == 0) {
+            continue;
+        }
+        if (auto limit = bucketLimit(bucket)) {
+            os << "  <  " << std::setw(9) << limit;
+        }
+        else {
+            os << "  >= " << std::setw(9) << bucketLimit(bucket - 1);
+        }
+        os << " us" << std::setw(20) << pauseHistogram[bucket] << '\n';
+    }
+}
+
+void GCStats::printJson(std::ostream& os) const
+{
+    auto const elapsed = toSeconds(Clock::now() - startTime);
+    auto tally = [&os](Tally const& tally) {
+        os << "{\"objects\": " << tally.objects << ", \"bytes\": " << tally.bytes << '}';
+    };
+
+    os << std::fixed << std::setprecision(3);
+    os << "{\n";
+    os << "  \"run_time_s\": " << elapsed << ",\n";
+    os << "  \"collections\": {\"full\": " << fullCollections << ", \"minor\": " << minorCollections << "},\n";
+
+    os << "  \"pauses\": {\"total_us\": " << toMicros(totalPause) << ", \"max_us\": " << toMicros(maxPause)
+       << ", \"histogram\": [";
+    for (size_t bucket = 0; bucket < pauseHistogram.size(); bucket++) {
+        os << (bucket > 0 ? ", " : "") << "{\"below_us\": ";
+        if (auto limit = bucketLimit(bucket)) {
+            os << limit;
+        }
+        else {
+            os << "null";
+        }
+        os << ", \"count\": " << pauseHistogram[bucket] << '}';
+    }
+    os << "]},\n";
+
+    os << "  \"allocated\": ";
+    tally(allocated);
+    os << ",\n  \"marked\": ";
+    tally(marked);
+    os << ",\n  \"freed\": ";
+    tally(freed);
+    os << ",\n  \"allocation_rate_bytes_per_s\": " << (elapsed > 0 ? allocated.bytes / elapsed : 0.0) << ",\n";
+    os << "  \"peak_heap_bytes\": " << peakHeapBytes << ",\n";
+
+    os << "  \"live\": {";
+    for (size_t kind = 0; kind < live.size(); kind++) {
+        os << (kind > 0 ? ", " : "") << '"' << kindName(kind) << "\": ";
+        tally(live[kind]);
+    }
+    os << "}\n";
+    os << "}\n";
+}
+
+} // namespace cloxx
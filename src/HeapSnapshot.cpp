@@ -0,0 +1,233 @@
+#include "HeapSnapshot.hpp"
+
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+
+#include "Environment.hpp"
+#include "GC.hpp"
+
+namespace cloxx {
+
+namespace {
+// Node and edge types, as indices into the type lists in the snapshot meta
+enum NodeType {
+    NODE_STRING = 2,
+    NODE_OBJECT = 3,
+    NODE_CLOSURE = 5,
+    NODE_SYNTHETIC = 9,
+};
+
+enum EdgeType {
+    EDGE_ELEMENT = 1,
+    EDGE_PROPERTY = 2,
+};
+
+char const* const meta = R"({"node_fields":["type","name","id","self_size","edge_count","trace_node_id",)"
+                         R"("detachedness"],)"
+                         R"("node_types":[["hidden","array","string","object","code","closure","regexp","number",)"
+                         R"("native","synthetic","concatenated string","sliced string","symbol","bigint"],)"
+                         R"("string","number","number","number","number","number"],)"
+                         R"("edge_fields":["type","name_or_index","to_node"],)"
+                         R"("edge_types":[["context","element","property","internal","hidden","shortcut","weak"],)"
+                         R"("string_or_number","node"],)"
+                         R"("trace_function_info_fields":[],"trace_node_fields":[],"sample_fields":[],)"
+                         R"("location_fields":[]})";
+
+size_t const nodeFieldCount = 7;
+
+NodeType nodeTypeOf(Traceable::Kind kind)
+{
+    switch (kind) {
+    case Traceable::Kind::STRING:
+        return NODE_STRING;
+    case Traceable::Kind::NATIVE_FUNCTION:
+    case Traceable::Kind::FUNCTION:
+    case Traceable::Kind::CLASS:
+        return NODE_CLOSURE;
+    case Traceable::Kind::ENVIRONMENT:
+    case Traceable::Kind::INSTANCE:
+        break;
+    }
+    return NODE_OBJECT;
+}
+
+void writeJsonString(std::ostream& os, std::string_view str)
+{
+    os << '"';
+    for (auto c : str) {
+        switch (c) {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        case '\n':
+            os << "\\n";
+            break;
+        case '\r':
+            os << "\\r";
+            break;
+        case '\t':
+            os << "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                os << escaped;
+            }
+            else {
+                os << c;
+            }
+        }
+    }
+    os << '"';
+}
+
+struct RootCollector : Traceable::Enumerator {
+    explicit RootCollector(std::vector<Traceable*>& roots) : roots{roots}
+    {}
+
+    void enumerate(Traceable& traceable) const override
+    {
+        roots.push_back(&traceable);
+    }
+
+    std::vector<Traceable*>& roots;
+};
+
+class SnapshotBuilder : Traceable::Describer {
+public:
+    struct Edge {
+        EdgeType type;
+        size_t nameOrIndex;
+        size_t toNode;
+    };
+
+    struct Node {
+        NodeType type;
+        size_t name;
+        size_t selfSize;
+        std::vector<Edge> edges;
+    };
+
+    SnapshotBuilder(GarbageCollector& gc, std::vector<std::string> const& globalNames)
+        : _globals{gc.root()}, _globalNames{globalNames}
+    {
+        // The synthetic root refers to all the roots of the collector.
+        _nodes.push_back({NODE_SYNTHETIC, intern("(GC roots)"), 0, {}});
+        std::vector<Traceable*> roots;
+        gc.enumerateRoots(RootCollector{roots});
+        for (size_t i = 0; i < roots.size(); i++) {
+            auto node = nodeOf(*roots[i]);
+            _nodes[0].edges.push_back({EDGE_ELEMENT, i, node});
+        }
+
+        // Nodes are appended as they are discovered, so this is a breadth
+        // first walk of the heap.
+        for (size_t i = 1; i < _nodes.size(); i++) {
+            _current = i;
+            auto name = _traceables[i - 1]->describe(*this);
+            _nodes[i].name = intern(name);
+        }
+    }
+
+    void write(std::ostream& os) const
+    {
+        size_t edgeCount = 0;
+        for (auto& node : _nodes) {
+            edgeCount += node.edges.size();
+        }
+
+        os << R"({"snapshot":{"meta":)" << meta << R"(,"node_count":)" << _nodes.size() << R"(,"edge_count":)"
+           << edgeCount << R"(,"trace_function_count":0},)" << '\n';
+
+        os << R"("nodes":[)";
+        for (size_t i = 0; i < _nodes.size(); i++) {
+            auto& node = _nodes[i];
+            os << (i > 0 ? ",\n" : "") << node.type << ',' << node.name << ',' << i * 2 + 1 << ',' << node.selfSize
+               << ',' << node.edges.size() << ",0,0";
+        }
+        os << "],\n";
+
+        os << R"("edges":[)";
+        bool first = true;
+        for (auto& node : _nodes) {
+            for (auto& edge : node.edges) {
+                os << (first ? "" : ",\n") << edge.type << ',' << edge.nameOrIndex << ','
+                   << edge.toNode * nodeFieldCount;
+                first = false;
+            }
+        }
+        os << "],\n";
+
+        os << R"("trace_function_infos":[],"trace_tree":[],"samples":[],"locations":[],)" << '\n';
+
+        os << R"("strings":[)";
+        for (size_t i = 0; i < _strings.size(); i++) {
+            os << (i > 0 ? ",\n" : "");
+            writeJsonString(os, _strings[i]);
+        }
+        os << "]}\n";
+    }
+
+private:
+    void field(std::string_view name, Traceable& traceable) override
+    {
+        auto node = nodeOf(traceable);
+        _nodes[_current].edges.push_back({EDGE_PROPERTY, intern(name), node});
+    }
+
+    void element(size_t index, Traceable& traceable) override
+    {
+        // Name the slots of the global environment after their variables.
+        if (_traceables[_current - 1] == _globals && index < _globalNames.size()) {
+            field(_globalNames[index], traceable);
+            return;
+        }
+
+        auto node = nodeOf(traceable);
+        _nodes[_current].edges.push_back({EDGE_ELEMENT, index, node});
+    }
+
+    size_t nodeOf(Traceable& traceable)
+    {
+        auto [it, inserted] = _nodeIndices.emplace(&traceable, _nodes.size());
+        if (inserted) {
+            _nodes.push_back({nodeTypeOf(traceable.kind()), 0, traceable.allocationSize(), {}});
+            _traceables.push_back(&traceable);
+        }
+        return it->second;
+    }
+
+    size_t intern(std::string_view str)
+    {
+        auto [it, inserted] = _stringIndices.emplace(std::string{str}, _strings.size());
+        if (inserted) {
+            _strings.push_back(it->first);
+        }
+        return it->second;
+    }
+
+    Traceable const* const _globals;
+    std::vector<std::string> const& _globalNames;
+
+    std::vector<Node> _nodes;
+    std::vector<Traceable*> _traceables; // of _nodes[1..]
+    std::unordered_map<Traceable*, size_t> _nodeIndices;
+    size_t _current = 0;
+
+    std::vector<std::string> _strings;
+    std::unordered_map<std::string, size_t> _stringIndices;
+};
+} // namespace
+
+void writeHeapSnapshot(std::ostream& os, GarbageCollector& gc, std::vector<std::string> const& globalNames)
+{
+    SnapshotBuilder{gc, globalNames}.write(os);
+}
+
+} // namespace cloxx
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace cloxx {
+
+class GarbageCollector;
+
+// Writes every object reachable from the roots of `gc` in the .heapsnapshot
+// format of V8, which Chrome DevTools and other heap viewers can load.
+// `globalNames` holds the name of each global slot, indexed by slot.
+void writeHeapSnapshot(std::ostream& os, GarbageCollector& gc, std::vector<std::string> const& globalNames);
+
+} // namespace cloxx
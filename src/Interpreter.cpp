@@ -12,39 +12,8 @@
 
 namespace cloxx {
 
-namespace {
-
-template <typename T, size_t N>
-struct OperandErrorMessage {};
-
-template <>
-struct OperandErrorMessage<LoxNumber, 1> {
-    static auto get()
-    {
-        return "Operand must be a number.";
-    }
-};
-
-template <size_t N>
-struct OperandErrorMessage<LoxNumber, N> {
-    static auto get()
-    {
-        return "Operands must be numbers.";
-    }
-};
-
-template <size_t N>
-struct OperandErrorMessage<LoxString, N> {
-    static auto get()
-    {
-        return "Operands must be strings.";
-    }
-};
-
-} // namespace
-
-Interpreter::Interpreter(Lox* lox, GarbageCollector* gc)
-    : _lox{lox}, _gc{gc}, _globals{gc->root()}, _environment{_globals}
+Interpreter::Interpreter(Lox* lox, GarbageCollector* gc, PropertyCacheStats* cacheStats)
+    : _lox{lox}, _gc{gc}, _cacheStats{cacheStats}, _globals{gc->root()}, _environment{_globals}
 {}
 
 void Interpreter::interpret(std::vector<Stmt> const& stmts)
@@ -61,7 +30,7 @@ void Interpreter::interpret(std::vector<Stmt> const& stmts)
 
 void Interpreter::visit(BlockStmt const& stmt)
 {
-    auto blockEnv = _gc->create<Environment>(_environment);
+    auto blockEnv = _gc->create<Environment>(_gc, _environment);
     executeBlock(stmt.stmts, blockEnv);
 }
 
@@ -72,7 +41,8 @@ void Interpreter::visit(ExprStmt const& stmt)
 
 void Interpreter::visit(IfStmt const& stmt)
 {
-    if (evaluate(stmt.cond)->isTruthy()) {
+    // The completion of the branch is left for the caller to look at.
+    if (evaluate(stmt.cond).isTruthy()) {
         execute(stmt.thenBranch);
     }
     else if (stmt.elseBranch) {
@@ -82,73 +52,66 @@ void Interpreter::visit(IfStmt const& stmt)
 
 void Interpreter::visit(WhileStmt const& stmt)
 {
-    while (evaluate(stmt.cond)->isTruthy()) {
-        execute(stmt.body);
+    while (evaluate(stmt.cond).isTruthy()) {
+        if (execute(stmt.body) != Completion::NORMAL) {
+            return;
+        }
+        _gc->maybeCollect();
     }
 }
 
 void Interpreter::visit(ReturnStmt const& stmt)
 {
-    ReturnValue returnValue;
-    if (stmt.value) {
-        returnValue.object = evaluate(*stmt.value);
-    }
-    else {
-        returnValue.object = makeLoxNil();
-    }
-
-    throw returnValue;
+    _returnValue = stmt.value ? evaluate(*stmt.value) : makeLoxNil();
+    _completion = Completion::RETURN;
 }
 
 void Interpreter::visit(PrintStmt const& stmt)
 {
-    auto value = evaluate(stmt.expr);
-    LOX_ASSERT(value);
-    std::cout << value->toString() << '\n';
+    std::cout << evaluate(stmt.expr).toString() << '\n';
 }
 
 void Interpreter::visit(VarStmt const& stmt)
 {
-    std::shared_ptr<LoxObject> value;
+    Value value;
     if (stmt.initializer) {
         value = evaluate(*stmt.initializer);
     }
-    else {
-        value = makeLoxNil();
-    }
-    _environment->define(stmt.name.lexeme, value);
+    _environment->define(stmt.slot(), value);
 }
 
 void Interpreter::visit(FunStmt const& stmt)
 {
-    auto function = makeFunction(false, stmt.name, stmt.params, stmt.body);
-    _environment->define(stmt.name.lexeme, function);
+    auto function = makeFunction(stmt, false);
+    _environment->define(stmt.slot(), function);
 }
 
 void Interpreter::visit(ClassStmt const& stmt)
 {
-    std::shared_ptr<LoxClass> superclass;
+    LoxClass* superclass = nullptr;
     if (stmt.superclass) {
-        auto object = evaluate(*stmt.superclass);
-        superclass = std::dynamic_pointer_cast<LoxClass>(object);
+        auto value = evaluate(*stmt.superclass);
+        if (value.isObject(LoxObject::Kind::CLASS)) {
+            superclass = static_cast<LoxClass*>(value.asObject());
+        }
         if (!superclass) {
             throw RuntimeError(stmt.superclass->name, "Superclass must be a class.");
         }
     }
 
-    _environment->define(stmt.name.lexeme, makeLoxNil());
+    _environment->define(stmt.slot(), makeLoxNil());
 
     auto enclosingEnvironment = _environment;
     if (superclass) {
-        _environment = _gc->create<Environment>(_environment);
-        _environment->define("super", superclass);
+        _environment = _gc->create<Environment>(_gc, _environment);
+        _environment->define(0, superclass);
     }
 
-    std::map<std::string, std::shared_ptr<LoxFunction>> methods;
-    for (auto const& method : stmt.methods) {
-        bool isInitializer = method.name.lexeme == "init";
-        auto function = makeFunction(isInitializer, method.name, method.params, method.body);
-        methods.emplace(method.name.lexeme, function);
+    std::map<std::string, LoxFunction*> methods;
+    for (auto method : stmt.methods) {
+        bool isInitializer = method->name.lexeme == "init";
+        auto function = makeFunction(*method, isInitializer);
+        methods.emplace(method->name.lexeme, function);
     }
 
     auto klass = _gc->create<LoxClass>(_gc, stmt.name.lexeme, superclass, methods);
@@ -157,246 +120,236 @@ void Interpreter::visit(ClassStmt const& stmt)
         _environment = enclosingEnvironment;
     }
 
-    _environment->assign(stmt.name, klass);
+    _environment->assignAt(0, stmt.slot(), klass);
 }
 
-void Interpreter::visit(AssignExpr const& expr)
+Value Interpreter::visit(AssignExpr const& expr)
 {
     auto value = evaluate(expr.value);
-    LOX_ASSERT(value);
 
     if (expr.depth() >= 0) {
-        _environment->assignAt(expr.depth(), expr.name.lexeme, value);
+        _environment->assignAt(expr.depth(), expr.slot(), value);
     }
     else {
-        _globals->assign(expr.name, value);
+        _globals->assign(expr.slot(), expr.name, value);
     }
-    _evalResults.push_back(value);
+    return value;
 }
 
-void Interpreter::visit(BinaryExpr const& expr)
+Value Interpreter::visit(BinaryExpr const& expr)
 {
+    GarbageCollector::RootScope roots{_gc};
     auto left = evaluate(expr.left);
+    roots.add(left.toTraceable());
     auto right = evaluate(expr.right);
 
-    LOX_ASSERT(left);
-    LOX_ASSERT(right);
-
     switch (expr.op.type) {
     case Token::GREATER:
-        ensureOperands<LoxNumber>(expr.op, left, right, [this](double left, double right) {
-            _evalResults.push_back(toLoxBoolean(left > right));
-        });
-        break;
+        checkNumberOperands(expr.op, left, right);
+        return toLoxBoolean(left.asNumber() > right.asNumber());
     case Token::GREATER_EQUAL:
-        ensureOperands<LoxNumber>(expr.op, left, right, [this](double left, double right) {
-            _evalResults.push_back(toLoxBoolean(left >= right));
-        });
-        break;
+        checkNumberOperands(expr.op, left, right);
+        return toLoxBoolean(left.asNumber() >= right.asNumber());
     case Token::LESS:
-        ensureOperands<LoxNumber>(expr.op, left, right, [this](double left, double right) {
-            _evalResults.push_back(toLoxBoolean(left < right));
-        });
-        break;
+        checkNumberOperands(expr.op, left, right);
+        return toLoxBoolean(left.asNumber() < right.asNumber());
     case Token::LESS_EQUAL:
-        ensureOperands<LoxNumber>(expr.op, left, right, [this](double left, double right) {
-            _evalResults.push_back(toLoxBoolean(left <= right));
-        });
-        break;
+        checkNumberOperands(expr.op, left, right);
+        return toLoxBoolean(left.asNumber() <= right.asNumber());
     case Token::MINUS:
-        ensureOperands<LoxNumber>(expr.op, left, right, [this](double left, double right) {
-            _evalResults.push_back(toLoxNumber(left - right));
-        });
-        break;
+        checkNumberOperands(expr.op, left, right);
+        return toLoxNumber(left.asNumber() - right.asNumber());
     case Token::PLUS:
-        if (matchOperands<LoxNumber>(left, right, [this](double left, double right) {
-                _evalResults.push_back(toLoxNumber(left + right));
-            })) {
-            break; // handled number + number
+        if (left.isNumber() && right.isNumber()) {
+            return toLoxNumber(left.asNumber() + right.asNumber());
         }
-        if (matchOperands<LoxString>(left, right, [this](auto& left, auto& right) {
-                _evalResults.push_back(toLoxString(left + right));
-            })) {
-            break; // handled string + string
+        if (auto l = toString(left)) {
+            if (auto r = toString(right)) {
+                return _gc->concatenate(*l, *r);
+            }
         }
         throw RuntimeError(expr.op, "Operands must be two numbers or two strings.");
     case Token::SLASH:
-        ensureOperands<LoxNumber>(expr.op, left, right, [this](double left, double right) {
-            _evalResults.push_back(toLoxNumber(left / right));
-        });
-        break;
+        checkNumberOperands(expr.op, left, right);
+        return toLoxNumber(left.asNumber() / right.asNumber());
     case Token::STAR:
-        ensureOperands<LoxNumber>(expr.op, left, right, [this](double left, double right) {
-            _evalResults.push_back(toLoxNumber(left * right));
-        });
-        break;
+        checkNumberOperands(expr.op, left, right);
+        return toLoxNumber(left.asNumber() * right.asNumber());
     case Token::BANG_EQUAL:
-        _evalResults.push_back(toLoxBoolean(!left->equals(*right)));
-        break;
+        return toLoxBoolean(!left.equals(right));
     case Token::EQUAL_EQUAL:
-        _evalResults.push_back(toLoxBoolean(left->equals(*right)));
-        break;
+        return toLoxBoolean(left.equals(right));
     default:
         // Unreachable.
-        break;
+        LOX_ASSERT(false);
+        return makeLoxNil();
     }
 }
 
-void Interpreter::visit(CallExpr const& expr)
+Value Interpreter::visit(CallExpr const& expr)
 {
-    auto callee = evaluate(expr.callee);
+    GarbageCollector::RootScope roots{_gc};
+
+    // Methods called right away are invoked on their instance rather than
+    // bound to it first.
+    Value callee;
+    LoxInstance* receiver = nullptr;
+    if (auto get = expr.callee.toGetExpr()) {
+        auto instance = toInstance(evaluate(get->object));
+        if (!instance) {
+            throw RuntimeError(get->name, "Only instances have properties.");
+        }
+        if (auto method = instance->getMethod(get->name, get->cache, _cacheStats, callee)) {
+            callee = method;
+            receiver = instance;
+        }
+    }
+    else if (auto super = expr.callee.toSuperExpr()) {
+        callee = findSuperMethod(*super, receiver);
+    }
+    else {
+        callee = evaluate(expr.callee);
+    }
+    roots.add(callee.toTraceable());
+    if (receiver) {
+        roots.add(receiver);
+    }
 
-    std::vector<std::shared_ptr<LoxObject>> args;
+    std::vector<Value> args;
     for (auto const& arg : expr.args) {
         args.push_back(evaluate(arg));
+        roots.add(args.back().toTraceable());
     }
 
-    auto callable = dynamic_cast<LoxCallable*>(callee.get());
-    if (!callable) {
+    if (!callee.isObject() || !callee.asObject()->isCallable()) {
         throw RuntimeError(expr.paren, "Can only call functions and classes.");
     }
+    auto callable = static_cast<LoxCallable*>(callee.asObject());
 
     if (args.size() != callable->arity()) {
         throw RuntimeError(expr.paren, "Expected " + std::to_string(callable->arity()) + " arguments but got " +
                                            std::to_string(args.size()) + ".");
     }
 
-    _evalResults.push_back(callable->call(args));
+    if (receiver) {
+        return static_cast<LoxFunction*>(callable)->invoke(receiver, args);
+    }
+    return callable->call(args);
 }
 
-void Interpreter::visit(GetExpr const& expr)
+Value Interpreter::visit(GetExpr const& expr)
 {
     auto object = evaluate(expr.object);
 
-    if (auto instance = dynamic_cast<LoxInstance*>(object.get())) {
-        _evalResults.push_back(instance->get(expr.name));
-        return;
+    if (auto instance = toInstance(object)) {
+        return instance->get(expr.name, expr.cache, _cacheStats);
     }
 
     throw RuntimeError(expr.name, "Only instances have properties.");
 }
 
-void Interpreter::visit(GroupingExpr const& expr)
+Value Interpreter::visit(GroupingExpr const& expr)
 {
-    _evalResults.push_back(evaluate(expr.expr));
+    return evaluate(expr.expr);
 }
 
-void Interpreter::visit(LiteralExpr const& expr)
+Value Interpreter::visit(LiteralExpr const& expr)
 {
-    _evalResults.push_back(expr.value);
+    return expr.value;
 }
 
-void Interpreter::visit(LogicalExpr const& expr)
+Value Interpreter::visit(LogicalExpr const& expr)
 {
     auto left = evaluate(expr.left);
 
     // Check left and short-circuit if possible.
     if (expr.op.type == Token::OR) {
-        if (left->isTruthy()) {
-            _evalResults.push_back(left);
-            return;
+        if (left.isTruthy()) {
+            return left;
         }
     }
     else {
         LOX_ASSERT(expr.op.type == Token::AND);
-        if (!left->isTruthy()) {
-            _evalResults.push_back(left);
-            return;
+        if (!left.isTruthy()) {
+            return left;
         }
     }
 
-    _evalResults.push_back(evaluate(expr.right));
+    return evaluate(expr.right);
 }
 
-void Interpreter::visit(SetExpr const& expr)
+Value Interpreter::visit(SetExpr const& expr)
 {
+    GarbageCollector::RootScope roots{_gc};
     auto object = evaluate(expr.object);
+    roots.add(object.toTraceable());
 
-    if (auto instance = dynamic_cast<LoxInstance*>(object.get())) {
+    if (auto instance = toInstance(object)) {
         auto value = evaluate(expr.value);
-        instance->set(expr.name, value);
-
-        _evalResults.push_back(value);
-        return;
+        instance->set(expr.name, value, expr.cache, _cacheStats);
+        return value;
     }
 
     throw RuntimeError(expr.name, "Only instances have fields.");
 }
 
-void Interpreter::visit(ThisExpr const& expr)
+Value Interpreter::visit(ThisExpr const& expr)
 {
-    std::shared_ptr<LoxObject> object;
     if (expr.depth() >= 0) {
-        object = _environment->getAt(expr.depth(), expr.keyword.lexeme);
-    }
-    else {
-        object = _globals->get(expr.keyword);
+        return _environment->getAt(expr.depth(), expr.slot());
     }
-
-    _evalResults.push_back(object);
+    return _globals->get(expr.slot(), expr.keyword);
 }
 
-void Interpreter::visit(SuperExpr const& expr)
+Value Interpreter::visit(SuperExpr const& expr)
 {
-    LOX_ASSERT(expr.keyword.lexeme == "super");
-
-    if (expr.depth() >= 0) {
-        auto distance = expr.depth();
-        auto superclass = std::dynamic_pointer_cast<LoxClass>(_environment->getAt(distance, "super"));
-        auto instance = std::dynamic_pointer_cast<LoxInstance>(_environment->getAt(distance - 1, "this"));
-        if (superclass && instance) {
-            auto method = superclass->findMethod(expr.method.lexeme);
-            if (!method) {
-                throw RuntimeError(expr.method, "Undefined property '" + expr.method.lexeme + "'.");
-            }
-            _evalResults.push_back(method->bind(instance));
-            return;
-        }
-    }
-
-    LOX_ASSERT(false); // If we have reached here, we have a scope resolve bug.
+    LoxInstance* instance;
+    auto method = findSuperMethod(expr, instance);
+    return method->bind(instance);
 }
 
-void Interpreter::visit(UnaryExpr const& expr)
+Value Interpreter::visit(UnaryExpr const& expr)
 {
     auto right = evaluate(expr.right);
-    LOX_ASSERT(right);
 
     if (expr.op.type == Token::BANG) {
-        _evalResults.push_back(toLoxBoolean(!right->isTruthy()));
-    }
-    else {
-        LOX_ASSERT(expr.op.type == Token::MINUS);
-        ensureOperand<LoxNumber>(expr.op, right, [this](double value) {
-            _evalResults.push_back(toLoxNumber(-value));
-        });
+        return toLoxBoolean(!right.isTruthy());
     }
+
+    LOX_ASSERT(expr.op.type == Token::MINUS);
+    checkNumberOperand(expr.op, right);
+    return toLoxNumber(-right.asNumber());
 }
 
-void Interpreter::visit(VariableExpr const& expr)
+Value Interpreter::visit(VariableExpr const& expr)
 {
-    std::shared_ptr<LoxObject> object;
     if (expr.depth() >= 0) {
-        object = _environment->getAt(expr.depth(), expr.name.lexeme);
-    }
-    else {
-        object = _globals->get(expr.name);
+        return _environment->getAt(expr.depth(), expr.slot());
     }
-    _evalResults.push_back(object);
+    return _globals->get(expr.slot(), expr.name);
 }
 
-void Interpreter::execute(Stmt const& stmt)
+Interpreter::Completion Interpreter::execute(Stmt const& stmt)
 {
     stmt.accept(*this);
+    return _completion;
 }
 
-void Interpreter::executeBlock(std::vector<Stmt> const& stmts, std::shared_ptr<Environment> const& environment)
+Interpreter::Completion Interpreter::executeBlock(std::vector<Stmt> const& stmts, Environment* environment)
 {
+    // Once we switch to `environment`, the one we return to is referenced only
+    // from here. Rooting the active environment of every block keeps them all.
+    GarbageCollector::RootScope roots{_gc};
+    roots.add(environment);
+    _gc->maybeCollect();
+
     auto previous = _environment;
     try {
         _environment = environment;
         for (auto const& stmt : stmts) {
-            execute(stmt);
+            if (execute(stmt) != Completion::NORMAL) {
+                break;
+            }
         }
         _environment = previous;
     }
@@ -404,82 +357,78 @@ void Interpreter::executeBlock(std::vector<Stmt> const& stmts, std::shared_ptr<E
         _environment = previous;
         throw;
     }
+    return _completion;
 }
 
-std::shared_ptr<LoxObject> Interpreter::evaluate(Expr const& expr)
+Value Interpreter::evaluate(Expr const& expr)
 {
-#ifdef LOX_DEBUG
-    auto prevResultsCount = _evalResults.size();
-#endif
-
-    expr.accept(*this);
-
-#ifdef LOX_DEBUG
-    LOX_ASSERT(_evalResults.size() == prevResultsCount + 1);
-#endif
-
-    auto value = _evalResults.back();
-    _evalResults.pop_back();
-    return value;
+    return expr.accept(*this);
 }
 
-template <typename OperandType, typename Callback>
-bool Interpreter::matchOperand(std::shared_ptr<LoxObject> const& right, Callback&& callback)
+void Interpreter::checkNumberOperand(Token const& op, Value const& operand)
 {
-    if (auto r = dynamic_cast<OperandType*>(right.get())) {
-        callback(r->value);
-        return true;
+    if (!operand.isNumber()) {
+        throw RuntimeError{op, "Operand must be a number."};
     }
-    return false;
 }
 
-template <typename OperandType, typename Callback>
-void Interpreter::ensureOperand(Token const& op, std::shared_ptr<LoxObject> const& right, Callback&& callback)
+void Interpreter::checkNumberOperands(Token const& op, Value const& left, Value const& right)
 {
-    if (matchOperand<OperandType>(right, std::move(callback)))
-        return;
+    if (!left.isNumber() || !right.isNumber()) {
+        throw RuntimeError{op, "Operands must be numbers."};
+    }
+}
 
-    throw RuntimeError{op, OperandErrorMessage<OperandType, 1>::get()};
+LoxString* Interpreter::toString(Value const& value)
+{
+    if (value.isObject(LoxObject::Kind::STRING)) {
+        return static_cast<LoxString*>(value.asObject());
+    }
+    return nullptr;
 }
 
-template <typename OperandType, typename Callback>
-bool Interpreter::matchOperands(std::shared_ptr<LoxObject> const& left, std::shared_ptr<LoxObject> const& right,
-                                Callback&& callback)
+LoxInstance* Interpreter::toInstance(Value const& value)
 {
-    if (auto l = dynamic_cast<OperandType*>(left.get())) {
-        if (auto r = dynamic_cast<OperandType*>(right.get())) {
-            callback(l->value, r->value);
-            return true;
-        }
+    if (value.isObject(LoxObject::Kind::INSTANCE)) {
+        return static_cast<LoxInstance*>(value.asObject());
     }
-    return false;
+    return nullptr;
 }
 
-template <typename OperandType, typename Callback>
-void Interpreter::ensureOperands(Token const& op, std::shared_ptr<LoxObject> const& left,
-                                 std::shared_ptr<LoxObject> const& right, Callback&& callback)
+LoxFunction* Interpreter::findSuperMethod(SuperExpr const& expr, LoxInstance*& instance)
 {
-    if (matchOperands<OperandType>(left, right, std::move(callback)))
-        return;
+    LOX_ASSERT(expr.keyword.lexeme == "super");
+    LOX_ASSERT(expr.depth() > 0); // Otherwise, we have a scope resolve bug.
+
+    // "super" occupies the first slot of its own scope, which encloses the
+    // scope of the method with "this" in its first slot.
+    auto& superclass = _environment->getAt(expr.depth(), 0);
+    auto& object = _environment->getAt(expr.depth() - 1, 0);
+    LOX_ASSERT(superclass.isObject(LoxObject::Kind::CLASS) && object.isObject(LoxObject::Kind::INSTANCE));
 
-    throw RuntimeError{op, OperandErrorMessage<OperandType, 2>::get()};
+    auto method = static_cast<LoxClass&>(*superclass.asObject()).findMethod(expr.method.lexeme);
+    if (!method) {
+        throw RuntimeError(expr.method, "Undefined property '" + expr.method.lexeme + "'.");
+    }
+    instance = static_cast<LoxInstance*>(object.asObject());
+    return method;
 }
 
-std::shared_ptr<LoxFunction> Interpreter::makeFunction(bool isInitializer, Token const& name,
-                                                       std::vector<Token> const params, std::vector<Stmt> const& body)
+LoxFunction* Interpreter::makeFunction(FunStmt const& declaration, bool isInitializer)
 {
-    auto executor = [this](std::shared_ptr<Environment> const& env,
-                           std::vector<Stmt> const& stmts) -> std::shared_ptr<LoxObject> {
-        try {
-            executeBlock(stmts, env);
-        }
-        catch (ReturnValue& retVal) {
-            return retVal.object;
-        }
-        return makeLoxNil();
-    };
+    auto& proto = _protos[&declaration];
+    if (!proto) {
+        auto executor = [this](Environment* env, std::vector<Stmt> const& stmts) -> Value {
+            if (executeBlock(stmts, env) == Completion::RETURN) {
+                _completion = Completion::NORMAL;
+                return _returnValue;
+            }
+            return makeLoxNil();
+        };
+        proto = std::make_unique<FunctionProto>(declaration, isInitializer, executor);
+    }
 
-    return _gc->create<LoxFunction>(_gc, _environment, isInitializer, name, params, body, executor);
+    return _gc->create<LoxFunction>(_gc, *proto, _environment);
 }
 
 } // namespace cloxx
@@ -1,24 +1,28 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "ast/Expr.hpp"
 #include "ast/Stmt.hpp"
 
 #include "Environment.hpp"
+#include "LoxFunction.hpp"
 
 namespace cloxx {
 
 class Lox;
-class LoxObject;
-class LoxFunction;
+class LoxInstance;
+class LoxString;
 
 class GarbageCollector;
+struct PropertyCacheStats;
 
-class Interpreter : StmtVisitor, ExprVisitor {
+class Interpreter : StmtVisitor, ExprEvaluator {
 public:
-    Interpreter(Lox* lox, GarbageCollector* gc);
+    // Property lookups are counted into `cacheStats` unless it is null.
+    Interpreter(Lox* lox, GarbageCollector* gc, PropertyCacheStats* cacheStats);
 
     void interpret(std::vector<Stmt> const& stmts);
 
@@ -34,50 +38,55 @@ private:
     void visit(FunStmt const& stmt) override;
     void visit(ClassStmt const& stmt) override;
 
-    // ExprVisitor
-    void visit(AssignExpr const& expr) override;
-    void visit(BinaryExpr const& expr) override;
-    void visit(CallExpr const& expr) override;
-    void visit(GetExpr const& expr) override;
-    void visit(GroupingExpr const& expr) override;
-    void visit(LiteralExpr const& expr) override;
-    void visit(LogicalExpr const& expr) override;
-    void visit(SetExpr const& expr) override;
-    void visit(ThisExpr const& expr) override;
-    void visit(SuperExpr const& expr) override;
-    void visit(UnaryExpr const& expr) override;
-    void visit(VariableExpr const& expr) override;
-
-    void execute(Stmt const& stmt);
-    void executeBlock(std::vector<Stmt> const& stmts, std::shared_ptr<Environment> const& environment);
-
-    std::shared_ptr<LoxObject> evaluate(Expr const& expr);
-
-    template <typename OperandType, typename Callback>
-    bool matchOperand(std::shared_ptr<LoxObject> const& right, Callback&& callback);
-    template <typename OperandType, typename Callback>
-    void ensureOperand(Token const& op, std::shared_ptr<LoxObject> const& right, Callback&& callback);
-
-    template <typename OperandType, typename Callback>
-    bool matchOperands(std::shared_ptr<LoxObject> const& left, std::shared_ptr<LoxObject> const& right,
-                       Callback&& callback);
-    template <typename OperandType, typename Callback>
-    void ensureOperands(Token const& op, std::shared_ptr<LoxObject> const& left,
-                        std::shared_ptr<LoxObject> const& right, Callback&& callback);
-
-    std::shared_ptr<LoxFunction> makeFunction(bool isInitializer, Token const& name, std::vector<Token> const params,
-                                              std::vector<Stmt> const& body);
-
-    struct ReturnValue {
-        std::shared_ptr<LoxObject> object;
+    // ExprEvaluator
+    Value visit(AssignExpr const& expr) override;
+    Value visit(BinaryExpr const& expr) override;
+    Value visit(CallExpr const& expr) override;
+    Value visit(GetExpr const& expr) override;
+    Value visit(GroupingExpr const& expr) override;
+    Value visit(LiteralExpr const& expr) override;
+    Value visit(LogicalExpr const& expr) override;
+    Value visit(SetExpr const& expr) override;
+    Value visit(ThisExpr const& expr) override;
+    Value visit(SuperExpr const& expr) override;
+    Value visit(UnaryExpr const& expr) override;
+    Value visit(VariableExpr const& expr) override;
+
+    // How a statement finished. Anything but NORMAL skips the rest of the
+    // enclosing statements until it reaches what handles it, e.g. the body of
+    // the function for RETURN.
+    enum class Completion {
+        NORMAL,
+        RETURN,
     };
 
+    Completion execute(Stmt const& stmt);
+    Completion executeBlock(std::vector<Stmt> const& stmts, Environment* environment);
+
+    Value evaluate(Expr const& expr);
+
+    static void checkNumberOperand(Token const& op, Value const& operand);
+    static void checkNumberOperands(Token const& op, Value const& left, Value const& right);
+
+    static LoxString* toString(Value const& value);
+    static LoxInstance* toInstance(Value const& value);
+
+    // Finds the method `super` refers to and the instance to call it on.
+    LoxFunction* findSuperMethod(SuperExpr const& expr, LoxInstance*& instance);
+
+    LoxFunction* makeFunction(FunStmt const& declaration, bool isInitializer);
+
     Lox* const _lox;
     GarbageCollector* const _gc;
-    std::shared_ptr<Environment> _globals;
-    std::shared_ptr<Environment> _environment;
+    PropertyCacheStats* const _cacheStats;
+    Environment* const _globals;
+    Environment* _environment;
+
+    Completion _completion = Completion::NORMAL;
+    Value _returnValue; // valid while _completion is RETURN
 
-    std::vector<std::shared_ptr<LoxObject>> _evalResults;
+    // Made the first time a function is made from each declaration
+    std::unordered_map<FunStmt const*, std::unique_ptr<FunctionProto>> _protos;
 };
 
 } // namespace cloxx
@@ -1,39 +1,72 @@
 #include "Lox.hpp"
 
 #include "Assert.hpp"
+#include "ClosureInterpreter.hpp"
 #include "GC.hpp"
+#include "HeapSnapshot.hpp"
 #include "Interpreter.hpp"
 #include "LoxFunction.hpp"
 #include "LoxNativeFunction.hpp"
 #include "Parser.hpp"
+#include "PropertyCache.hpp"
 #include "Resolver.hpp"
 #include "RuntimeError.hpp"
 #include "Scanner.hpp"
+#include "VM.hpp"
 
 #include <chrono> // for clock() native function
+#include <fstream>
 #include <iostream>
 
 namespace cloxx {
 
 namespace {
-void defineBuiltins(std::shared_ptr<Environment> const& env)
+bool saveHeapSnapshot(std::string const& path, GarbageCollector& gc, Resolver const& resolver)
 {
+    std::ofstream ofs{path};
+    if (!ofs.is_open()) {
+        return false;
+    }
+    writeHeapSnapshot(ofs, gc, resolver.globalNames());
+    return ofs.good();
+}
+
+void defineBuiltins(GarbageCollector& gc, Resolver& resolver)
+{
+    auto env = gc.root();
     LOX_ASSERT(env);
-    env->define("clock", std::make_shared<LoxNativeFunction>(0, [](auto& /*args*/) {
+    env->define(resolver.globalSlot("clock"), gc.create<LoxNativeFunction>(0, [](auto& /*args*/) {
                     auto duration = std::chrono::steady_clock::now().time_since_epoch();
                     auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
                     return toLoxNumber(millis / 1000.0);
                 }));
+
+    // Writes a heap snapshot to a new file in the current directory and
+    // returns its name, or nil if it could not be written.
+    env->define(resolver.globalSlot("heapSnapshot"),
+                gc.create<LoxNativeFunction>(0, [&gc, &resolver, count = 0](auto& /*args*/) mutable {
+                    auto duration = std::chrono::system_clock::now().time_since_epoch();
+                    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
+                    auto path = "cloxx-" + std::to_string(seconds) + "-" + std::to_string(++count) + ".heapsnapshot";
+                    if (!saveHeapSnapshot(path, gc, resolver)) {
+                        return makeLoxNil();
+                    }
+                    return Value{gc.intern(path)};
+                }));
 }
 } // namespace
 
-Lox::Lox()
+Lox::Lox(GCConfig const& gcConfig, Backend backend, bool cacheStats)
+    : _gcConfig{gcConfig}, _backend{backend}, _cacheStats{cacheStats}
 {}
 
 int Lox::run(std::string source)
 {
-    Scanner scanner{this, std::move(source)};
-    Parser parser{this, scanner.scanTokens()};
+    GarbageCollector gc{_gcConfig};
+
+    Scanner scanner{this, &gc, std::move(source)};
+    AstArena arena;
+    Parser parser{this, &arena, scanner.scanTokens()};
 
     auto stmts = parser.parse();
 
@@ -42,14 +75,11 @@ int Lox::run(std::string source)
         return 65;
     }
 
-    GarbageCollector gc;
+    Resolver resolver{this};
 
     // Define built-in global object such as "clock"
-    defineBuiltins(gc.root());
-
-    Interpreter interpreter{this, &gc};
+    defineBuiltins(gc, resolver);
 
-    Resolver resolver{this};
     resolver.resolve(stmts);
 
     // Stop if there was a resolution error.
@@ -57,9 +87,36 @@ int Lox::run(std::string source)
         return 65;
     }
 
-    for (auto const& stmt : stmts) {
-        interpreter.interpret({stmt});
-        gc.collect();
+    PropertyCacheStats cacheStats;
+    auto const countedCacheStats = _cacheStats ? &cacheStats : nullptr;
+
+    // Functions refer to what the backend made of their declarations, so the
+    // heap is looked at while the backend is still around.
+    auto execute = [&](auto& backend) {
+        for (auto const& stmt : stmts) {
+            backend.interpret({stmt});
+            gc.maybeCollect();
+        }
+
+        gc.stats().print(std::cerr, _gcConfig.stats);
+        if (_cacheStats) {
+            cacheStats.print(std::cerr);
+        }
+        if (!_gcConfig.heapSnapshotPath.empty() && !saveHeapSnapshot(_gcConfig.heapSnapshotPath, gc, resolver)) {
+            std::cerr << "Error: Cannot write heap snapshot to '" << _gcConfig.heapSnapshotPath << "'!\n";
+        }
+    };
+    if (_backend == Backend::VM) {
+        VM vm{this, &gc, countedCacheStats};
+        execute(vm);
+    }
+    else if (_backend == Backend::CLOSURE) {
+        ClosureInterpreter interpreter{this, &gc, countedCacheStats};
+        execute(interpreter);
+    }
+    else {
+        Interpreter interpreter{this, &gc, countedCacheStats};
+        execute(interpreter);
     }
 
     // Indicate a run-time error in the exit code.
@@ -4,6 +4,8 @@
 #include <string>
 #include <string_view>
 
+#include "GC.hpp"
+
 namespace cloxx {
 
 struct Token;
@@ -14,7 +16,13 @@ class RuntimeError;
 
 class Lox {
 public:
-    Lox();
+    enum class Backend {
+        INTERPRETER, // walks the AST
+        CLOSURE,     // compiles the AST to a tree of closures first
+        VM,          // compiles to bytecode first
+    };
+
+    explicit Lox(GCConfig const& gcConfig = {}, Backend backend = Backend::INTERPRETER, bool cacheStats = false);
 
 public:
     int run(std::string source);
@@ -26,6 +34,12 @@ public:
 private:
     void report(size_t line, std::string_view where, std::string_view message);
 
+    GCConfig const _gcConfig;
+    Backend const _backend;
+
+    // Whether to print the statistics of the property caches at exit
+    bool const _cacheStats;
+
     bool _hadError = false;
     bool _hadRuntimeError = false;
 };
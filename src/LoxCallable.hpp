@@ -1,13 +1,19 @@
 #pragma once
 
+#include <vector>
+
 #include "LoxObject.hpp"
+#include "Value.hpp"
 
 namespace cloxx {
 
 class LoxCallable : public LoxObject {
 public:
+    LoxCallable(PrivateCreationTag tag, Kind kind) : LoxObject{tag, kind}
+    {}
+
     virtual size_t arity() const = 0;
-    virtual std::shared_ptr<LoxObject> call(std::vector<std::shared_ptr<LoxObject>> const& args) = 0;
+    virtual Value call(std::vector<Value> const& args) = 0;
 };
 
 } // namespace cloxx
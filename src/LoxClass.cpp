@@ -6,13 +6,21 @@
 
 namespace cloxx {
 
-LoxClass::LoxClass(PrivateCreationTag tag, GarbageCollector* gc, std::string name,
-                   std::shared_ptr<LoxClass> const& superclass,
-                   std::map<std::string, std::shared_ptr<LoxFunction>> methods)
-    : Traceable{tag}, _gc{gc}, _name{std::move(name)}, _superclass{superclass}, _methods{std::move(methods)}
+namespace {
+std::uint64_t lastClassId = 0;
+} // namespace
+
+LoxClass::LoxClass(PrivateCreationTag tag, GarbageCollector* gc, std::string name, LoxClass* superclass,
+                   std::map<std::string, LoxFunction*> methods)
+    : LoxCallable{tag, Kind::CLASS},
+      _gc{gc},
+      _id{++lastClassId},
+      _name{std::move(name)},
+      _superclass{superclass},
+      _methods{std::move(methods)}
 {}
 
-std::shared_ptr<LoxFunction> LoxClass::findMethod(std::string const& name) const
+LoxFunction* LoxClass::findMethod(std::string const& name) const
 {
     if (auto it = _methods.find(name); it != _methods.end()) {
         return it->second;
@@ -39,12 +47,14 @@ size_t LoxClass::arity() const
     return 0;
 }
 
-std::shared_ptr<LoxObject> LoxClass::call(std::vector<std::shared_ptr<LoxObject>> const& args)
+Value LoxClass::call(std::vector<Value> const& args)
 {
-    auto instance = _gc->create<LoxInstance>(shared_from_this());
+    GarbageCollector::RootScope roots{_gc};
+    auto instance = _gc->create<LoxInstance>(_gc, this);
+    roots.add(instance);
 
     if (auto initializer = findMethod("init")) {
-        initializer->bind(instance)->call(args);
+        initializer->invoke(instance, args);
     }
 
     return instance;
@@ -61,10 +71,16 @@ void LoxClass::enumerateTraceables(Traceable::Enumerator const& enumerator)
     }
 }
 
-void LoxClass::reclaim()
+std::string LoxClass::describe(Describer& describer)
 {
-    _superclass.reset();
-    _methods.clear();
+    if (_superclass) {
+        describer.field("superclass", *_superclass);
+    }
+
+    for (auto& [name, method] : _methods) {
+        describer.field(name, *method);
+    }
+    return _name;
 }
 
 } // namespace cloxx
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 
 #include "GC.hpp"
@@ -9,27 +10,34 @@ namespace cloxx {
 
 class LoxFunction;
 
-class LoxClass : public LoxCallable, public Traceable, public std::enable_shared_from_this<LoxClass> {
+class LoxClass : public LoxCallable {
 public:
-    LoxClass(PrivateCreationTag tag, GarbageCollector* gc, std::string name,
-             std::shared_ptr<LoxClass> const& superclass, std::map<std::string, std::shared_ptr<LoxFunction>> methods);
+    LoxClass(PrivateCreationTag tag, GarbageCollector* gc, std::string name, LoxClass* superclass,
+             std::map<std::string, LoxFunction*> methods);
 
-    std::shared_ptr<LoxFunction> findMethod(std::string const& name) const;
+    LoxFunction* findMethod(std::string const& name) const;
+
+    // Unique among all the classes ever created
+    std::uint64_t id() const
+    {
+        return _id;
+    }
 
     std::string toString() const override;
 
     size_t arity() const override;
-    std::shared_ptr<LoxObject> call(std::vector<std::shared_ptr<LoxObject>> const& args) override;
+    Value call(std::vector<Value> const& args) override;
 
     // GC support
     void enumerateTraceables(Traceable::Enumerator const& enumerator) override;
-    void reclaim() override;
+    std::string describe(Describer& describer) override;
 
 private:
     GarbageCollector* const _gc;
+    std::uint64_t const _id;
     std::string _name;
-    std::shared_ptr<LoxClass> _superclass;
-    std::map<std::string, std::shared_ptr<LoxFunction>> _methods;
+    LoxClass* const _superclass;
+    std::map<std::string, LoxFunction*> const _methods;
 };
 
 } // namespace cloxx
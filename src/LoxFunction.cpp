@@ -10,60 +10,86 @@
 
 namespace cloxx {
 
-LoxFunction::LoxFunction(PrivateCreationTag tag, GarbageCollector* gc, std::shared_ptr<Environment> const& closure,
-                         bool isInitializer, Token const& name, std::vector<Token> const& params,
-                         std::vector<Stmt> const& body, Executor const& executor)
-    : Traceable{tag}, _gc{gc}, _closure{closure},
-      _isInitializer{isInitializer}, _name{name}, _params{params}, _body{body}, _executor{executor}
+FunctionProto::FunctionProto(FunStmt const& declaration, bool isInitializer, Executor executor, Chunk const* chunk)
+    : declaration{declaration}, isInitializer{isInitializer}, arity{declaration.params.size()},
+      frameSize{declaration.frameSize}, executor{std::move(executor)}, chunk{chunk}
+{}
+
+LoxFunction::LoxFunction(PrivateCreationTag tag, GarbageCollector* gc, FunctionProto const& proto,
+                         Environment* closure, LoxInstance* receiver)
+    : LoxCallable{tag, Kind::FUNCTION}, _gc{gc}, _proto{&proto}, _closure{closure}, _receiver{receiver}
 {
     LOX_ASSERT(_closure);
 }
 
-std::shared_ptr<LoxFunction> LoxFunction::bind(std::shared_ptr<LoxInstance> const& instance) const
+LoxFunction* LoxFunction::bind(LoxInstance* instance) const
 {
     LOX_ASSERT(instance);
 
-    auto closure = _gc->create<Environment>(_closure);
-    closure->define("this", instance);
-    return _gc->create<LoxFunction>(_gc, closure, _isInitializer, _name, _params, _body, _executor);
+    return _gc->create<LoxFunction>(_gc, *_proto, _closure, instance);
+}
+
+Value LoxFunction::invoke(LoxInstance* receiver, std::vector<Value> const& args)
+{
+    LOX_ASSERT(receiver);
+    LOX_ASSERT(args.size() == _proto->arity);
+
+    auto env = _gc->create<Environment>(_gc, _closure, _proto->frameSize);
+    env->define(0, receiver);
+    for (size_t i = 0; i < args.size(); i++) {
+        env->define(i + 1, args[i]);
+    }
+
+    if (_proto->isInitializer) {
+        _proto->executor(env, _proto->declaration.body);
+        return receiver;
+    }
+
+    return _proto->executor(env, _proto->declaration.body);
 }
 
 std::string LoxFunction::toString() const
 {
-    return "<fn " + _name.lexeme + ">";
+    return "<fn " + _proto->declaration.name.lexeme + ">";
 }
 
 size_t LoxFunction::arity() const
 {
-    return _params.size();
+    return _proto->arity;
 }
 
-std::shared_ptr<LoxObject> LoxFunction::call(std::vector<std::shared_ptr<LoxObject>> const& args)
+Value LoxFunction::call(std::vector<Value> const& args)
 {
-    LOX_ASSERT(args.size() == _params.size());
-
-    auto env = _gc->create<Environment>(_closure);
-    for (size_t i = 0; i < _params.size(); i++) {
-        env->define(_params[i].lexeme, args[i]);
+    if (_receiver) {
+        return invoke(_receiver, args);
     }
 
-    if (_isInitializer) {
-        _executor(env, _body);
-        return _closure->getAt(0, "this");
+    LOX_ASSERT(args.size() == _proto->arity);
+
+    auto env = _gc->create<Environment>(_gc, _closure, _proto->frameSize);
+    for (size_t i = 0; i < args.size(); i++) {
+        env->define(i, args[i]);
     }
 
-    return _executor(env, _body);
+    return _proto->executor(env, _proto->declaration.body);
 }
 
 void LoxFunction::enumerateTraceables(Traceable::Enumerator const& enumerator)
 {
     LOX_ASSERT(_closure);
     enumerator.enumerate(*_closure);
+    if (_receiver) {
+        enumerator.enumerate(*_receiver);
+    }
 }
 
-void LoxFunction::reclaim()
+std::string LoxFunction::describe(Describer& describer)
 {
-    _closure.reset();
+    describer.field("closure", *_closure);
+    if (_receiver) {
+        describer.field("this", *_receiver);
+    }
+    return _proto->declaration.name.lexeme;
 }
 
 } // namespace cloxx
@@ -1,50 +1,94 @@
 #pragma once
 
 #include <functional>
-#include <memory>
 #include <string>
 #include <vector>
 
 #include "GC.hpp"
 #include "LoxCallable.hpp"
-#include "Token.hpp"
 
 namespace cloxx {
 
 class Stmt;
+class FunStmt;
 class Environment;
 class LoxInstance;
+struct Chunk;
 
-class LoxFunction : public LoxCallable, public Traceable {
+// What all the functions made from one declaration share, so that making a
+// closure or binding a method only takes a few words. Backends make one per
+// declaration and keep it as long as they run the program.
+struct FunctionProto {
+    using Executor = std::function<Value(Environment*, std::vector<Stmt> const&)>;
+
+    FunctionProto(FunStmt const& declaration, bool isInitializer, Executor executor, Chunk const* chunk = nullptr);
+
+    FunctionProto(FunctionProto const&) = delete;
+    FunctionProto& operator=(FunctionProto const&) = delete;
+
+    FunStmt const& declaration;
+    bool const isInitializer;
+    size_t const arity;
+
+    // Slots of the environment of a call: "this" for methods, then the
+    // parameters and the variables declared in the body
+    size_t const frameSize;
+
+    Executor const executor;
+
+    // Bytecode of the body, for functions compiled for the VM, which calls
+    // them without going through the executor
+    Chunk const* const chunk;
+};
+
+class LoxFunction : public LoxCallable {
 public:
-    using Executor =
-        std::function<std::shared_ptr<LoxObject>(std::shared_ptr<Environment> const&, std::vector<Stmt> const&)>;
+    using Executor = FunctionProto::Executor;
+
+    LoxFunction(PrivateCreationTag tag, GarbageCollector* gc, FunctionProto const& proto, Environment* closure,
+                LoxInstance* receiver = nullptr);
+
+    // Methods get the instance they are called on in the first slot of their
+    // environment, ahead of the arguments. Calling a method right away
+    // invokes it on the instance; using it as a value binds it first.
+    LoxFunction* bind(LoxInstance* instance) const;
+    Value invoke(LoxInstance* receiver, std::vector<Value> const& args);
+
+    // The instance a method was bound to, if any
+    LoxInstance* receiver() const
+    {
+        return _receiver;
+    }
 
-    LoxFunction(PrivateCreationTag tag, GarbageCollector* gc, std::shared_ptr<Environment> const& closure,
-                bool isInitializer, Token const& name, std::vector<Token> const& params, std::vector<Stmt> const& body,
-                Executor const& executor);
+    Environment* closure() const
+    {
+        return _closure;
+    }
 
-    std::shared_ptr<LoxFunction> bind(std::shared_ptr<LoxInstance> const& instance) const;
+    bool isInitializer() const
+    {
+        return _proto->isInitializer;
+    }
+
+    FunctionProto const& proto() const
+    {
+        return *_proto;
+    }
 
     std::string toString() const override;
 
     size_t arity() const override;
-    std::shared_ptr<LoxObject> call(std::vector<std::shared_ptr<LoxObject>> const& args) override;
+    Value call(std::vector<Value> const& args) override;
 
     // GC support
     void enumerateTraceables(Traceable::Enumerator const& enumerator) override;
-    void reclaim() override;
+    std::string describe(Describer& describer) override;
 
 private:
     GarbageCollector* const _gc;
-
-    std::shared_ptr<Environment> _closure;
-
-    bool const _isInitializer;
-    Token const _name;
-    std::vector<Token> const _params;
-    std::vector<Stmt> const _body;
-    Executor const _executor;
+    FunctionProto const* const _proto;
+    Environment* const _closure;
+    LoxInstance* const _receiver;
 };
 
 } // namespace cloxx
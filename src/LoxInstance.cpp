@@ -3,32 +3,78 @@
 #include "Assert.hpp"
 #include "LoxClass.hpp"
 #include "LoxFunction.hpp"
+#include "PropertyCache.hpp"
 #include "RuntimeError.hpp"
 #include "Token.hpp"
 
 namespace cloxx {
 
-LoxInstance::LoxInstance(PrivateCreationTag tag, std::shared_ptr<LoxClass> const& klass) : Traceable{tag}, _class{klass}
+LoxInstance::LoxInstance(PrivateCreationTag tag, GarbageCollector* gc, LoxClass* klass)
+    : LoxObject{tag, Kind::INSTANCE}, _gc{gc}, _class{klass}, _shape{gc->emptyShape()}
 {
     LOX_ASSERT(_class);
 }
 
-std::shared_ptr<LoxObject> LoxInstance::get(Token const& name)
+Value LoxInstance::get(Token const& name, PropertyCache& cache, PropertyCacheStats* stats)
 {
-    if (auto it = _fields.find(name.lexeme); it != _fields.end()) {
-        return it->second;
+    Value field;
+    if (auto method = getMethod(name, cache, stats, field)) {
+        return method->bind(this);
+    }
+    return field;
+}
+
+LoxFunction* LoxInstance::getMethod(Token const& name, PropertyCache& cache, PropertyCacheStats* stats, Value& field)
+{
+    if (auto entry = cache.find(_shape, _class->id(), stats)) {
+        if (!entry->method) {
+            field = _fields[entry->slot];
+        }
+        return entry->method;
+    }
+
+    if (auto slot = _shape->find(name.lexeme); slot != Shape::notFound) {
+        cache.add({_shape, _class->id(), nullptr, slot, _shape}, stats);
+        field = _fields[slot];
+        return nullptr;
     }
 
     if (auto method = _class->findMethod(name.lexeme)) {
-        return method->bind(std::dynamic_pointer_cast<LoxInstance>(shared_from_this()));
+        cache.add({_shape, _class->id(), method, Shape::notFound, _shape}, stats);
+        return method;
     }
 
     throw RuntimeError(name, "Undefined property '" + name.lexeme + "'.");
 }
 
-void LoxInstance::set(Token const& name, std::shared_ptr<LoxObject> const& value)
+void LoxInstance::set(Token const& name, Value const& value, PropertyCache& cache, PropertyCacheStats* stats)
 {
-    _fields[name.lexeme] = value;
+    PropertyCache::Entry miss;
+    auto entry = cache.find(_shape, _class->id(), stats);
+    if (!entry) {
+        auto slot = _shape->find(name.lexeme);
+        if (slot != Shape::notFound) {
+            miss = {_shape, _class->id(), nullptr, slot, _shape};
+        }
+        else {
+            miss = {_shape, _class->id(), nullptr, _fields.size(), _shape->withField(name.lexeme)};
+        }
+        cache.add(miss, stats);
+        entry = &miss;
+    }
+
+    if (entry->transition == _shape) {
+        _fields[entry->slot] = value;
+    }
+    else {
+        _shape = entry->transition;
+        auto const capacity = _fields.capacity();
+        _fields.push_back(value);
+        if (_fields.capacity() != capacity) {
+            _gc->grow(this, (_fields.capacity() - capacity) * sizeof(Value));
+        }
+    }
+    _gc->writeBarrier(this, value.toTraceable());
 }
 
 std::string LoxInstance::toString() const
@@ -40,17 +86,23 @@ void LoxInstance::enumerateTraceables(Enumerator const& enumerator)
 {
     enumerator.enumerate(*_class);
 
-    for (auto& [_, field] : _fields) {
-        if (auto traceable = dynamic_cast<Traceable*>(field.get())) {
-            enumerator.enumerate(*traceable);
+    for (auto& field : _fields) {
+        if (field.isObject()) {
+            enumerator.enumerate(*field.asObject());
         }
     }
 }
 
-void LoxInstance::reclaim()
+std::string LoxInstance::describe(Describer& describer)
 {
-    _class.reset();
-    _fields.clear();
+    describer.field("class", *_class);
+
+    for (size_t slot = 0; slot < _fields.size(); slot++) {
+        if (_fields[slot].isObject()) {
+            describer.field(_shape->fieldName(slot), *_fields[slot].asObject());
+        }
+    }
+    return _class->toString();
 }
 
 } // namespace cloxx
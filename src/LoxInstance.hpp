@@ -1,31 +1,51 @@
 #pragma once
 
-#include <map>
+#include <vector>
 
 #include "GC.hpp"
 #include "LoxObject.hpp"
+#include "Value.hpp"
 
 namespace cloxx {
 
 class LoxClass;
+class LoxFunction;
+class PropertyCache;
+struct PropertyCacheStats;
 struct Token;
 
-class LoxInstance : public LoxObject, public Traceable, public std::enable_shared_from_this<LoxInstance> {
+class LoxInstance : public LoxObject {
 public:
-    LoxInstance(PrivateCreationTag tag, std::shared_ptr<LoxClass> const& klass);
+    LoxInstance(PrivateCreationTag tag, GarbageCollector* gc, LoxClass* klass);
 
-    std::shared_ptr<LoxObject> get(Token const& name);
-    void set(Token const& name, std::shared_ptr<LoxObject> const& value);
+    // Each place in the program accessing properties has its own cache.
+    // Lookups are counted into `stats` unless it is null.
+    Value get(Token const& name, PropertyCache& cache, PropertyCacheStats* stats);
+
+    // Like get, but leaves a method unbound, to be invoked on this instance
+    // right away. Returns null for a field and stores its value in `field`.
+    LoxFunction* getMethod(Token const& name, PropertyCache& cache, PropertyCacheStats* stats, Value& field);
+
+    void set(Token const& name, Value const& value, PropertyCache& cache, PropertyCacheStats* stats);
 
     std::string toString() const override;
 
     // GC support
+    size_t payloadSize() const override
+    {
+        return _fields.capacity() * sizeof(Value);
+    }
+
     void enumerateTraceables(Enumerator const& enumerator) override;
-    void reclaim() override;
+    std::string describe(Describer& describer) override;
 
 private:
-    std::shared_ptr<LoxClass> _class;
-    std::map<std::string, std::shared_ptr<LoxObject>> _fields;
+    GarbageCollector* const _gc;
+    LoxClass* const _class;
+
+    // Values of the fields in the slots given by the shape
+    Shape* _shape;
+    std::vector<Value> _fields;
 };
 
 } // namespace cloxx
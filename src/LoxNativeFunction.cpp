@@ -2,7 +2,8 @@
 
 namespace cloxx {
 
-LoxNativeFunction::LoxNativeFunction(size_t arity, Body body) : _arity{arity}, _body{std::move(body)}
+LoxNativeFunction::LoxNativeFunction(PrivateCreationTag tag, size_t arity, Body body)
+    : LoxCallable{tag, Kind::NATIVE_FUNCTION}, _arity{arity}, _body{std::move(body)}
 {}
 
 std::string LoxNativeFunction::toString() const
@@ -15,9 +16,17 @@ size_t LoxNativeFunction::arity() const
     return _arity;
 }
 
-std::shared_ptr<LoxObject> LoxNativeFunction::call(std::vector<std::shared_ptr<LoxObject>> const& args)
+Value LoxNativeFunction::call(std::vector<Value> const& args)
 {
     return _body(args);
 }
 
+void LoxNativeFunction::enumerateTraceables(Enumerator const& /*enumerator*/)
+{}
+
+std::string LoxNativeFunction::describe(Describer& /*describer*/)
+{
+    return toString();
+}
+
 } // namespace cloxx
\ No newline at end of file
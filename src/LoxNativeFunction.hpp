@@ -8,14 +8,18 @@ namespace cloxx {
 
 class LoxNativeFunction : public LoxCallable {
 public:
-    using Body = std::function<std::shared_ptr<LoxObject>(std::vector<std::shared_ptr<LoxObject>> const&)>;
+    using Body = std::function<Value(std::vector<Value> const&)>;
 
-    LoxNativeFunction(size_t arity, Body body);
+    LoxNativeFunction(PrivateCreationTag tag, size_t arity, Body body);
 
     std::string toString() const override;
 
     size_t arity() const override;
-    std::shared_ptr<LoxObject> call(std::vector<std::shared_ptr<LoxObject>> const& args) override;
+    Value call(std::vector<Value> const& args) override;
+
+    // GC support
+    void enumerateTraceables(Enumerator const& enumerator) override;
+    std::string describe(Describer& describer) override;
 
 private:
     size_t const _arity;
@@ -1,147 +1,115 @@
 #include "LoxObject.hpp"
 
+#include <algorithm>
+
+#include "Assert.hpp"
+
 namespace cloxx {
 
 // LoxObject
 
-#ifdef CLOXX_GC_DEBUG
-namespace {
-size_t objectInstanceCount = 0;
-}
+LoxObject::LoxObject(PrivateCreationTag tag, Kind kind) : Traceable{tag, kind}
+{}
 
-LoxObject::LoxObject()
-{
-    objectInstanceCount += 1;
-}
+// LoxString
 
-LoxObject::~LoxObject()
-{
-    objectInstanceCount -= 1;
-}
+LoxString::LoxString(PrivateCreationTag tag, std::string value, size_t hash)
+    : LoxObject{tag, Kind::STRING}, _value{std::move(value)}, _hash{hash}, _payloadSize{_value.size()}
+{}
 
-size_t LoxObject::instanceCount()
+LoxString::LoxString(PrivateCreationTag tag, GarbageCollector* gc, std::shared_ptr<std::string> buffer, size_t length,
+                     size_t bufferGrowth)
+    : LoxObject{tag, Kind::STRING}, _gc{gc}, _buffer{std::move(buffer)}, _length{length}, _payloadSize{bufferGrowth}
 {
-    return objectInstanceCount;
+    LOX_ASSERT(_gc);
+    LOX_ASSERT(_buffer && _buffer->size() >= _length);
 }
-#endif
 
-bool LoxObject::isTruthy() const
+LoxString* LoxString::concatenate(GarbageCollector* gc, LoxString const& left, LoxString const& right)
 {
-    return true;
-}
+    auto const length = left.length() + right.length();
+
+    // If `left` ends where its buffer ends, nobody else has appended to the
+    // buffer yet and we can extend it in place. Views into the buffer never
+    // change, so existing strings sharing it are unaffected.
+    if (left._buffer && left._length == left._buffer->size()) {
+        auto const capacity = left._buffer->capacity();
+        if (right._buffer == left._buffer) {
+            // `right` is a view into the buffer we're about to grow.
+            left._buffer->append(std::string{right.value()});
+        }
+        else {
+            left._buffer->append(right.value());
+        }
+        return gc->create<LoxString>(gc, left._buffer, length, left._buffer->capacity() - capacity);
+    }
 
-bool LoxObject::equals(LoxObject const& object) const
-{
-    return this == &object;
+    auto buffer = std::make_shared<std::string>();
+    buffer->reserve(std::max<size_t>(length * 2, 16));
+    buffer->append(left.value());
+    buffer->append(right.value());
+    auto const capacity = buffer->capacity();
+    return gc->create<LoxString>(gc, std::move(buffer), length, capacity);
 }
 
-// LoxNil
-
-std::string LoxNil::toString() const
+std::string_view LoxString::value() const
 {
-    return "nil";
+    if (isInterned()) {
+        return _value;
+    }
+    if (_canonical) {
+        return _canonical->value();
+    }
+    return std::string_view{_buffer->data(), _length};
 }
 
-bool LoxNil::isTruthy() const
+size_t LoxString::length() const
 {
-    return false;
+    return isInterned() ? _value.size() : _length;
 }
 
-bool LoxNil::equals(LoxObject const& object) const
+size_t LoxString::hash() const
 {
-    if (LoxObject::equals(object)) {
-        return true;
-    }
-
-    return dynamic_cast<LoxNil const*>(&object) != nullptr;
+    return canonical()._hash;
 }
 
-// LoxNumber
-
-LoxNumber::LoxNumber(double value) : value{value}
-{}
-
-std::string LoxNumber::toString() const
+bool LoxString::isInterned() const
 {
-    auto str = std::to_string(value);
-
-    // Remove trailing zeros.
-    while (str.size() > 1) {
-        char c = str.back();
-        if (c == '0') {
-            str.pop_back();
-        }
-        else {
-            if (c == '.')
-                str.pop_back();
-            break;
-        }
-    }
-    return str;
+    return _gc == nullptr;
 }
 
-bool LoxNumber::equals(LoxObject const& object) const
+LoxString const& LoxString::canonical() const
 {
-    if (LoxObject::equals(object)) {
-        return true;
+    if (isInterned()) {
+        return *this;
     }
 
-    if (auto num = dynamic_cast<LoxNumber const*>(&object)) {
-        return value == num->value;
+    if (!_canonical) {
+        _canonical = _gc->intern(std::string{value()});
+        _gc->writeBarrier(const_cast<LoxString*>(this), _canonical);
+        _buffer.reset();
     }
-
-    return false;
+    return *_canonical;
 }
 
-// LoxString
-
-LoxString::LoxString(std::string value) : value{std::move(value)}
-{}
-
 std::string LoxString::toString() const
 {
-    return value;
+    return std::string{value()};
 }
 
-bool LoxString::equals(LoxObject const& object) const
+void LoxString::enumerateTraceables(Enumerator const& enumerator)
 {
-    if (LoxObject::equals(object)) {
-        return true;
+    if (_canonical) {
+        enumerator.enumerate(*_canonical);
     }
-
-    if (auto str = dynamic_cast<LoxString const*>(&object)) {
-        return value == str->value;
-    }
-
-    return false;
 }
 
-// LoxBoolean
-
-LoxBoolean::LoxBoolean(bool value) : value{value}
-{}
-
-std::string LoxBoolean::toString() const
-{
-    return value ? "true" : "false";
-}
-
-bool LoxBoolean::isTruthy() const
+std::string LoxString::describe(Describer& describer)
 {
-    return value;
-}
-
-bool LoxBoolean::equals(LoxObject const& object) const
-{
-    if (LoxObject::equals(object)) {
-        return true;
+    if (_canonical) {
+        describer.field("canonical", *_canonical);
     }
-
-    if (auto b = dynamic_cast<LoxBoolean const*>(&object)) {
-        return value == b->value;
-    }
-
-    return false;
+    return toString();
 }
 
 } // namespace cloxx
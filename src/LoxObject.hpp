@@ -2,83 +2,70 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
+
+#include "GC.hpp"
 
 namespace cloxx {
 
-class LoxObject {
+class LoxObject : public Traceable {
 public:
-#ifdef CLOXX_GC_DEBUG
-    LoxObject();
-    virtual ~LoxObject();
+    LoxObject(PrivateCreationTag tag, Kind kind);
 
-    static size_t instanceCount();
-#else
-    virtual ~LoxObject() = default;
-#endif
+    bool isCallable() const
+    {
+        auto k = kind();
+        return k == Kind::NATIVE_FUNCTION || k == Kind::FUNCTION || k == Kind::CLASS;
+    }
 
     virtual std::string toString() const = 0;
-    virtual bool isTruthy() const;
-    virtual bool equals(LoxObject const& object) const;
-};
-
-class LoxNil : public LoxObject {
-public:
-    std::string toString() const override;
-    bool isTruthy() const override;
-    bool equals(LoxObject const& object) const override;
-};
-
-class LoxNumber : public LoxObject {
-public:
-    explicit LoxNumber(double value);
-
-    std::string toString() const override;
-    bool equals(LoxObject const& object) const override;
-
-    double const value;
 };
 
+// A LoxString is either interned through StringTable or the result of a
+// concatenation. Interned strings are equal if and only if they are the same
+// object. Concatenation results are views into a shared, append-only buffer so
+// that `s = s + piece` in a loop does not copy `s`; they are interned lazily,
+// the first time they are compared.
 class LoxString : public LoxObject {
 public:
-    explicit LoxString(std::string value);
+    LoxString(PrivateCreationTag tag, std::string value, size_t hash);
+    LoxString(PrivateCreationTag tag, GarbageCollector* gc, std::shared_ptr<std::string> buffer, size_t length,
+              size_t bufferGrowth);
 
-    std::string toString() const override;
-    bool equals(LoxObject const& object) const override;
+    static LoxString* concatenate(GarbageCollector* gc, LoxString const& left, LoxString const& right);
 
-    std::string const value;
-};
+    std::string_view value() const;
+    size_t length() const;
+    size_t hash() const;
 
-class LoxBoolean : public LoxObject {
-public:
-    explicit LoxBoolean(bool value);
+    bool isInterned() const;
+    LoxString const& canonical() const;
 
     std::string toString() const override;
-    bool isTruthy() const override;
-    bool equals(LoxObject const& object) const override;
 
-    bool const value;
+    // GC support
+    size_t payloadSize() const override
+    {
+        return _payloadSize;
+    }
+
+    void enumerateTraceables(Enumerator const& enumerator) override;
+    std::string describe(Describer& describer) override;
+
+private:
+    // Interned strings
+    std::string const _value;
+    size_t const _hash = 0;
+
+    // Concatenation results
+    GarbageCollector* const _gc = nullptr;
+    mutable std::shared_ptr<std::string> _buffer;
+    size_t const _length = 0;
+    mutable LoxString* _canonical = nullptr;
+
+    // The characters of an interned string, or what a concatenation added to
+    // the capacity of the buffer it shares
+    size_t const _payloadSize;
 };
 
-// Helper functions.
-
-inline auto makeLoxNil()
-{
-    return std::make_shared<LoxNil>();
-}
-
-inline auto toLoxNumber(double value)
-{
-    return std::make_shared<LoxNumber>(value);
-}
-
-inline auto toLoxString(std::string value)
-{
-    return std::make_shared<LoxString>(std::move(value));
-}
-
-inline auto toLoxBoolean(bool value)
-{
-    return std::make_shared<LoxBoolean>(value);
-}
-
 } // namespace cloxx
@@ -0,0 +1,282 @@
+#include "ParallelMarker.hpp"
+
+#include "Assert.hpp"
+#include "GC.hpp"
+
+namespace cloxx {
+
+// A Chase-Lev deque, in the formulation for weak memory models by Lê et al.
+// The worker owning it pushes and pops at the bottom without locking, while
+// other workers steal from the top. Only a steal, or a pop of the last item,
+// takes a compare-and-swap.
+class ParallelMarker::WorkDeque {
+public:
+    WorkDeque()
+    {
+        _arrays.push_back(std::make_unique<Array>(initialCapacity));
+        _array = _arrays.back().get();
+    }
+
+    WorkDeque(WorkDeque const&) = delete;
+    WorkDeque& operator=(WorkDeque const&) = delete;
+
+    // Only for the owner
+    void push(Traceable* traceable)
+    {
+        auto bottom = _bottom.load(std::memory_order_relaxed);
+        auto top = _top.load(std::memory_order_acquire);
+        auto array = _array.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<std::int64_t>(array->mask)) {
+            array = grow(array, top, bottom);
+        }
+        array->put(bottom, traceable);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // Only for the owner. Returns null once the deque is empty.
+    Traceable* pop()
+    {
+        auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+        auto array = _array.load(std::memory_order_relaxed);
+        _bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = _top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        auto traceable = array->get(bottom);
+        if (top == bottom) {
+            // The last item, which a thief may take first
+            if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                traceable = nullptr;
+            }
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return traceable;
+    }
+
+    // Returns null if the deque is empty or another thread got there first.
+    Traceable* steal()
+    {
+        auto top = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto bottom = _bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        auto traceable = _array.load(std::memory_order_acquire)->get(top);
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return traceable;
+    }
+
+    bool isEmpty() const
+    {
+        return _top.load(std::memory_order_acquire) >= _bottom.load(std::memory_order_acquire);
+    }
+
+    // Frees the arrays the deque has outgrown. Thieves may still read them
+    // while marking, so this waits until nobody marks.
+    void trim()
+    {
+        _arrays.erase(_arrays.begin(), _arrays.end() - 1);
+    }
+
+private:
+    static constexpr size_t initialCapacity = 1024;
+
+    struct Array {
+        explicit Array(size_t capacity) : mask{capacity - 1}, slots{new std::atomic<Traceable*>[capacity]}
+        {
+            LOX_ASSERT((capacity & mask) == 0);
+        }
+
+        Traceable* get(std::int64_t index) const
+        {
+            return slots[static_cast<size_t>(index) & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t index, Traceable* traceable)
+        {
+            slots[static_cast<size_t>(index) & mask].store(traceable, std::memory_order_relaxed);
+        }
+
+        size_t const mask;
+        std::unique_ptr<std::atomic<Traceable*>[]> const slots;
+    };
+
+    Array* grow(Array* array, std::int64_t top, std::int64_t bottom)
+    {
+        auto bigger = std::make_unique<Array>((array->mask + 1) * 2);
+        for (auto index = top; index < bottom; index++) {
+            bigger->put(index, array->get(index));
+        }
+        _arrays.push_back(std::move(bigger));
+        _array.store(_arrays.back().get(), std::memory_order_release);
+        return _arrays.back().get();
+    }
+
+    // The owner writes the bottom and thieves the top, so they don't share a
+    // cache line.
+    alignas(64) std::atomic<std::int64_t> _top{0};
+    alignas(64) std::atomic<std::int64_t> _bottom{0};
+    std::atomic<Array*> _array;
+    std::vector<std::unique_ptr<Array>> _arrays;
+};
+
+struct ParallelMarker::Worker {
+    explicit Worker(size_t index) : index{index}
+    {}
+
+    size_t const index;
+    WorkDeque deque;
+};
+
+ParallelMarker::ParallelMarker(size_t threadCount)
+{
+    LOX_ASSERT(threadCount > 0);
+    for (size_t i = 0; i < threadCount; i++) {
+        _workers.push_back(std::make_unique<Worker>(i));
+    }
+
+    // The thread calling mark() does the work of the first worker.
+    for (size_t i = 1; i < threadCount; i++) {
+        _threads.emplace_back([this, i] { runThread(*_workers[i]); });
+    }
+}
+
+ParallelMarker::~ParallelMarker()
+{
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _isStopping = true;
+    }
+    _started.notify_all();
+
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void ParallelMarker::mark(std::vector<Traceable*> const& roots)
+{
+    // The other threads wait for the mark to start, so their deques may be
+    // filled from here. Deal the roots out so that every thread has
+    // something to start with.
+    for (auto& worker : _workers) {
+        worker->deque.trim();
+    }
+    for (size_t i = 0; i < roots.size(); i++) {
+        if (roots[i]->tryMark()) {
+            _workers[i % _workers.size()]->deque.push(roots[i]);
+        }
+    }
+
+    _activeCount = _workers.size();
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _markCount++;
+        _runningCount = _threads.size();
+    }
+    _started.notify_all();
+
+    run(*_workers[0]);
+
+    std::unique_lock<std::mutex> lock{_mutex};
+    _finished.wait(lock, [this] { return _runningCount == 0; });
+}
+
+void ParallelMarker::runThread(Worker& worker)
+{
+    std::uint64_t markCount = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _started.wait(lock, [this, markCount] { return _isStopping || _markCount != markCount; });
+            if (_isStopping) {
+                return;
+            }
+            markCount = _markCount;
+        }
+
+        run(worker);
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (--_runningCount == 0) {
+            _finished.notify_one();
+        }
+    }
+}
+
+void ParallelMarker::run(Worker& worker)
+{
+    while (true) {
+        while (auto traceable = worker.deque.pop()) {
+            trace(worker, *traceable);
+        }
+
+        if (steal(worker)) {
+            continue;
+        }
+
+        // Out of work. Nobody else can produce more once every worker is
+        // idle, because a worker empties its deque before it idles.
+        _activeCount.fetch_sub(1);
+        while (true) {
+            if (_activeCount.load() == 0) {
+                return;
+            }
+
+            bool hasWork = false;
+            for (auto& victim : _workers) {
+                hasWork = hasWork || !victim->deque.isEmpty();
+            }
+            if (hasWork) {
+                _activeCount.fetch_add(1);
+                if (steal(worker)) {
+                    break;
+                }
+                _activeCount.fetch_sub(1);
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ParallelMarker::trace(Worker& worker, Traceable& traceable)
+{
+    struct Marker : Traceable::Enumerator {
+        explicit Marker(WorkDeque& deque) : deque{deque}
+        {}
+
+        void enumerate(Traceable& traceable) const override
+        {
+            if (traceable.tryMark()) {
+                deque.push(&traceable);
+            }
+        }
+
+        WorkDeque& deque;
+    };
+    traceable.enumerateTraceables(Marker{worker.deque});
+}
+
+bool ParallelMarker::steal(Worker& thief)
+{
+    for (size_t i = 1; i < _workers.size(); i++) {
+        auto& victim = *_workers[(thief.index + i) % _workers.size()];
+        if (auto traceable = victim.deque.steal()) {
+            thief.deque.push(traceable);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace cloxx
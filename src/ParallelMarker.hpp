@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cloxx {
+
+class Traceable;
+
+// ParallelMarker marks everything reachable from a set of roots using a number
+// of threads. Each thread traces from its own work-stealing deque, which idle
+// threads steal from. The threads are started once and wait for the next
+// collection in between. The heap must not be mutated while marking.
+class ParallelMarker {
+public:
+    explicit ParallelMarker(size_t threadCount);
+    ~ParallelMarker();
+
+    ParallelMarker(ParallelMarker const&) = delete;
+    ParallelMarker& operator=(ParallelMarker const&) = delete;
+
+    // Marks on the calling thread and all the others, returning once all of
+    // them are done.
+    void mark(std::vector<Traceable*> const& roots);
+
+private:
+    class WorkDeque;
+    struct Worker;
+
+    void runThread(Worker& worker);
+    void run(Worker& worker);
+    void trace(Worker& worker, Traceable& traceable);
+    bool steal(Worker& thief);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<size_t> _activeCount{0};
+
+    // Threads other than the one calling mark() wait here between marks.
+    std::mutex _mutex;
+    std::condition_variable _started;
+    std::condition_variable _finished;
+    std::uint64_t _markCount = 0;
+    size_t _runningCount = 0;
+    bool _isStopping = false;
+    std::vector<std::thread> _threads;
+};
+
+} // namespace cloxx
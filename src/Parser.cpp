@@ -7,7 +7,8 @@
 
 namespace cloxx {
 
-Parser::Parser(Lox* lox, std::vector<Token> tokens) : _lox{lox}, _tokens{std::move(tokens)}
+Parser::Parser(Lox* lox, AstArena* arena, std::vector<Token> tokens)
+    : _lox{lox}, _arena{arena}, _tokens{std::move(tokens)}
 {}
 
 std::vector<Stmt> Parser::parse()
@@ -61,10 +62,10 @@ Stmt Parser::varDeclaration()
     }
 
     consume(Token::SEMICOLON, "Expect ';' after variable declaration.");
-    return makeVarStmt(name, initializer);
+    return makeVarStmt(*_arena, name, initializer);
 }
 
-FunStmt Parser::function(std::string const& kind)
+FunStmt const& Parser::function(std::string const& kind)
 {
     // function   → IDENTIFIER "(" parameters? ")" block ;
     // parameters → IDENTIFIER ( "," IDENTIFIER )* ;
@@ -86,7 +87,7 @@ FunStmt Parser::function(std::string const& kind)
     consume(Token::LEFT_BRACE, "Expect '{' before " + kind + " body.");
     auto const body = block();
 
-    return makeFunStmt(name, params, body);
+    return makeFunStmt(*_arena, name, params, body);
 }
 
 Stmt Parser::classDeclaration()
@@ -98,22 +99,22 @@ Stmt Parser::classDeclaration()
 
     auto const& name = consume(Token::IDENTIFIER, "Expect class name.");
 
-    std::optional<VariableExpr> superclass;
+    VariableExpr const* superclass = nullptr;
     if (match(Token::LESS)) {
         consume(Token::IDENTIFIER, "Expect superclass name.");
-        superclass.emplace(makeVariableExpr(previous()));
+        superclass = &makeVariableExpr(*_arena, previous());
     }
 
     consume(Token::LEFT_BRACE, "Expect '{' before class body.");
 
-    std::vector<FunStmt> methods;
+    std::vector<FunStmt const*> methods;
     while (!check(Token::RIGHT_BRACE) && !isAtEnd()) {
-        methods.push_back(function("method"));
+        methods.push_back(&function("method"));
     }
 
     consume(Token::RIGHT_BRACE, "Expect '}' after class body.");
 
-    return makeClassStmt(name, superclass, methods);
+    return makeClassStmt(*_arena, name, superclass, methods);
 }
 
 Stmt Parser::statement()
@@ -142,7 +143,7 @@ Stmt Parser::statement()
         return printStatement();
     }
     if (match(Token::LEFT_BRACE)) {
-        return makeBlockStmt(block());
+        return makeBlockStmt(*_arena, block());
     }
     return expressionStatement();
 }
@@ -163,7 +164,7 @@ Stmt Parser::ifStatement()
         elseBranch = statement();
     }
 
-    return makeIfStmt(condition, thenBranch, elseBranch);
+    return makeIfStmt(*_arena, condition, thenBranch, elseBranch);
 }
 
 Stmt Parser::whileStatement()
@@ -178,7 +179,7 @@ Stmt Parser::whileStatement()
 
     auto const body = statement();
 
-    return makeWhileStmt(cond, body);
+    return makeWhileStmt(*_arena, cond, body);
 }
 
 Stmt Parser::forStatement()
@@ -205,7 +206,7 @@ Stmt Parser::forStatement()
 
     std::optional<Stmt> increment;
     if (!check(Token::RIGHT_PAREN)) {
-        increment = makeExprStmt(expression());
+        increment = makeExprStmt(*_arena, expression());
     }
     consume(Token::RIGHT_PAREN, "Expect ')' after for clauses.");
 
@@ -215,18 +216,18 @@ Stmt Parser::forStatement()
 
     // 1. Append increament to body if needed
     if (increment) {
-        body = makeBlockStmt(std::vector<Stmt>{body, *increment});
+        body = makeBlockStmt(*_arena, std::vector<Stmt>{body, *increment});
     }
 
     // 2. Make condition if missing and buid while statement
     if (!condition) {
-        condition = makeLiteralExpr(toLoxBoolean(true));
+        condition = makeLiteralExpr(*_arena, toLoxBoolean(true));
     }
-    body = makeWhileStmt(*condition, body);
+    body = makeWhileStmt(*_arena, *condition, body);
 
     // 3. Prepand initializer if needed
     if (initializer) {
-        body = makeBlockStmt(std::vector<Stmt>{*initializer, body});
+        body = makeBlockStmt(*_arena, std::vector<Stmt>{*initializer, body});
     }
 
     return body;
@@ -244,21 +245,21 @@ Stmt Parser::returnStatement()
         consume(Token::SEMICOLON, "Expect ';' after return value.");
     }
 
-    return makeReturnStmt(keyword, expr);
+    return makeReturnStmt(*_arena, keyword, expr);
 }
 
 Stmt Parser::printStatement()
 {
     auto const value = expression();
     consume(Token::SEMICOLON, "Expect ';' after value.");
-    return makePrintStmt(value);
+    return makePrintStmt(*_arena, value);
 }
 
 Stmt Parser::expressionStatement()
 {
     auto const expr = expression();
     consume(Token::SEMICOLON, "Expect ';' after expression.");
-    return makeExprStmt(expr);
+    return makeExprStmt(*_arena, expr);
 }
 
 std::vector<Stmt> Parser::block()
@@ -297,11 +298,11 @@ Expr Parser::assignment()
         auto const& value = assignment();
 
         if (auto const var = expr.toVariableExpr()) {
-            return makeAssignExpr(var->name, value);
+            return makeAssignExpr(*_arena, var->name, value);
         }
 
         if (auto const get = expr.toGetExpr()) {
-            return makeSetExpr(get->object, get->name, value);
+            return makeSetExpr(*_arena, get->object, get->name, value);
         }
 
         _lox->error(equals, "Invalid assignment target.");
@@ -319,7 +320,7 @@ Expr Parser::logicalOr()
     while (match(Token::OR)) {
         auto const& op = previous();
         auto const& right = logicalAnd();
-        expr = makeLogicalExpr(op, expr, right);
+        expr = makeLogicalExpr(*_arena, op, expr, right);
     }
 
     return expr;
@@ -334,7 +335,7 @@ Expr Parser::logicalAnd()
     while (match(Token::AND)) {
         auto const& op = previous();
         auto const& right = equality();
-        expr = makeLogicalExpr(op, expr, right);
+        expr = makeLogicalExpr(*_arena, op, expr, right);
     }
 
     return expr;
@@ -349,7 +350,7 @@ Expr Parser::equality()
     while (match(Token::BANG_EQUAL, Token::EQUAL_EQUAL)) {
         auto const& op = previous();
         auto const& right = comparison();
-        expr = makeBinaryExpr(op, expr, right);
+        expr = makeBinaryExpr(*_arena, op, expr, right);
     }
 
     return expr;
@@ -364,7 +365,7 @@ Expr Parser::comparison()
     while (match(Token::GREATER, Token::GREATER_EQUAL, Token::LESS, Token::LESS_EQUAL)) {
         auto const& op = previous();
         auto const& right = term();
-        expr = makeBinaryExpr(op, expr, right);
+        expr = makeBinaryExpr(*_arena, op, expr, right);
     }
 
     return expr;
@@ -379,7 +380,7 @@ Expr Parser::term()
     while (match(Token::MINUS, Token::PLUS)) {
         auto const& op = previous();
         auto const& right = factor();
-        expr = makeBinaryExpr(op, expr, right);
+        expr = makeBinaryExpr(*_arena, op, expr, right);
     }
 
     return expr;
@@ -391,7 +392,7 @@ Expr Parser::factor()
     while (match(Token::SLASH, Token::STAR)) {
         auto const& op = previous();
         auto const& right = unary();
-        expr = makeBinaryExpr(op, expr, right);
+        expr = makeBinaryExpr(*_arena, op, expr, right);
     }
     return expr;
 }
@@ -403,7 +404,7 @@ Expr Parser::unary()
     if (match(Token::BANG, Token::MINUS)) {
         auto const& op = previous();
         auto const& right = unary();
-        return makeUnaryExpr(op, right);
+        return makeUnaryExpr(*_arena, op, right);
     }
     return call();
 }
@@ -421,7 +422,7 @@ Expr Parser::call()
         }
         else if (match(Token::DOT)) {
             auto const& name = consume(Token::IDENTIFIER, "Expect property name after '.'.");
-            expr = makeGetExpr(expr, name);
+            expr = makeGetExpr(*_arena, expr, name);
         }
         else {
             break;
@@ -444,7 +445,7 @@ Expr Parser::finishCall(Expr const& callee)
     }
 
     auto const& paren = consume(Token::RIGHT_PAREN, "Expect ')' after arguments.");
-    return makeCallExpr(callee, paren, args);
+    return makeCallExpr(*_arena, callee, paren, args);
 }
 
 Expr Parser::primary()
@@ -456,40 +457,40 @@ Expr Parser::primary()
     //         | "super" "." IDENTIFIER ;
 
     if (match(Token::FALSE)) {
-        return makeLiteralExpr(toLoxBoolean(false));
+        return makeLiteralExpr(*_arena, toLoxBoolean(false));
     }
 
     if (match(Token::TRUE)) {
-        return makeLiteralExpr(toLoxBoolean(true));
+        return makeLiteralExpr(*_arena, toLoxBoolean(true));
     }
 
     if (match(Token::NIL)) {
-        return makeLiteralExpr(makeLoxNil());
+        return makeLiteralExpr(*_arena, makeLoxNil());
     }
 
     if (match(Token::NUMBER, Token::STRING)) {
-        return makeLiteralExpr(previous().literal);
+        return makeLiteralExpr(*_arena, previous().literal);
     }
 
     if (match(Token::LEFT_PAREN)) {
         auto const& expr = expression();
         consume(Token::RIGHT_PAREN, "Expect ')' after expression.");
-        return makeGroupingExpr(expr);
+        return makeGroupingExpr(*_arena, expr);
     }
 
     if (match(Token::IDENTIFIER)) {
-        return makeVariableExpr(previous());
+        return makeVariableExpr(*_arena, previous());
     }
 
     if (match(Token::THIS)) {
-        return makeThisExpr(previous());
+        return makeThisExpr(*_arena, previous());
     }
 
     if (match(Token::SUPER)) {
         auto const& keyword = previous();
         consume(Token::DOT, "Expect '.' after 'super'.");
         auto const& method = consume(Token::IDENTIFIER, "Expect superclass method name.");
-        return makeSuperExpr(keyword, method);
+        return makeSuperExpr(*_arena, keyword, method);
     }
 
     throw error(peek(), "Expect expression.");
@@ -14,14 +14,15 @@ class Lox;
 
 class Parser {
 public:
-    explicit Parser(Lox* lox, std::vector<Token> tokens);
+    // The nodes of the syntax tree are made in `arena`.
+    Parser(Lox* lox, AstArena* arena, std::vector<Token> tokens);
 
     std::vector<Stmt> parse();
 
 private:
     std::optional<Stmt> declaration();
     Stmt varDeclaration();
-    FunStmt function(std::string const& kind);
+    FunStmt const& function(std::string const& kind);
     Stmt classDeclaration();
     Stmt statement();
     Stmt ifStatement();
@@ -68,6 +69,7 @@ private:
     void synchronize();
 
     Lox* const _lox;
+    AstArena* const _arena;
     std::vector<Token> const _tokens;
     size_t _current = 0;
 };
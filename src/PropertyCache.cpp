@@ -0,0 +1,21 @@
+#include "PropertyCache.hpp"
+
+#include <iomanip>
+#include <ostream>
+
+namespace cloxx {
+
+void PropertyCacheStats::print(std::ostream& os) const
+{
+    auto lookups = hits + misses;
+    os << std::fixed << std::setprecision(1);
+    os << "Property cache statistics:\n";
+    os << "  lookups             " << std::setw(12) << lookups << '\n';
+    os << "  hits                " << std::setw(12) << hits << std::setw(8)
+       << (lookups ? 100.0 * hits / lookups : 0.0) << " %\n";
+    os << "  misses              " << std::setw(12) << misses << std::setw(8)
+       << (lookups ? 100.0 * misses / lookups : 0.0) << " %\n";
+    os << "  megamorphic misses  " << std::setw(12) << megamorphicMisses << '\n';
+}
+
+} // namespace cloxx
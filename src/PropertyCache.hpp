@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+namespace cloxx {
+
+class LoxFunction;
+class Shape;
+
+// How often property lookups were answered by the caches of the places they
+// were made at. Each run of a program counts into its own, and only when
+// asked to.
+struct PropertyCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+
+    // Misses at places that had already seen too many kinds of instances to
+    // remember another one
+    size_t megamorphicMisses = 0;
+
+    void print(std::ostream& os) const;
+};
+
+// Remembers where a property was found at one place in the program, for the
+// few kinds of instances seen there. Fields are found by the shape of the
+// instance alone. Methods are found by the shape, which tells that no field
+// hides them, and by the class. Classes are told apart by id rather than by
+// address, which a new class may take over once the old one is collected.
+class PropertyCache {
+public:
+    static constexpr size_t capacity = 4;
+
+    struct Entry {
+        Shape* shape;
+        std::uint64_t classId;
+
+        // The method, or null for a field in `slot`
+        LoxFunction* method;
+        size_t slot;
+
+        // Shape of the instance after setting the field, which differs from
+        // `shape` when the field gets added
+        Shape* transition;
+    };
+
+    // Both count into `stats` unless it is null.
+    Entry const* find(Shape const* shape, std::uint64_t classId, PropertyCacheStats* stats) const
+    {
+        for (size_t i = 0; i < _size; i++) {
+            auto& entry = _entries[i];
+            if (entry.shape == shape && (!entry.method || entry.classId == classId)) {
+                if (stats) {
+                    stats->hits++;
+                }
+                return &entry;
+            }
+        }
+        if (stats) {
+            stats->misses++;
+        }
+        return nullptr;
+    }
+
+    // Remembers the entry unless the place has seen too many kinds of
+    // instances already.
+    void add(Entry const& entry, PropertyCacheStats* stats)
+    {
+        if (_size < capacity) {
+            _entries[_size++] = entry;
+        }
+        else if (stats) {
+            stats->megamorphicMisses++;
+        }
+    }
+
+private:
+    std::array<Entry, capacity> _entries;
+    size_t _size = 0;
+};
+
+} // namespace cloxx
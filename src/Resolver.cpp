@@ -16,6 +16,24 @@ void Resolver::resolve(std::vector<Stmt> const& stmts)
     }
 }
 
+int Resolver::globalSlot(std::string const& name)
+{
+    auto it = _globalSlots.find(name);
+    if (it == _globalSlots.end()) {
+        it = _globalSlots.emplace(name, static_cast<int>(_globalSlots.size())).first;
+    }
+    return it->second;
+}
+
+std::vector<std::string> Resolver::globalNames() const
+{
+    std::vector<std::string> names(_globalSlots.size());
+    for (auto& [name, slot] : _globalSlots) {
+        names[slot] = name;
+    }
+    return names;
+}
+
 void Resolver::resolve(Stmt const& stmt)
 {
     stmt.accept(*this);
@@ -28,7 +46,7 @@ void Resolver::resolve(Expr const& expr)
 
 Resolver::Scope& Resolver::beginScope()
 {
-    _scopes.push_back({});
+    _scopes.push_back({{}, _functionDepth});
     return _scopes.back();
 }
 
@@ -37,54 +55,100 @@ void Resolver::endScope()
     _scopes.pop_back();
 }
 
+void Resolver::capture(Scope const& scope, Variable& variable)
+{
+    if (scope.functionDepth < _functionDepth) {
+        variable.isCaptured = true;
+    }
+}
+
+std::vector<bool> Resolver::captures() const
+{
+    auto& variables = _scopes.back().variables;
+    std::vector<bool> captured(variables.size());
+    for (auto& [_, variable] : variables) {
+        captured[variable.slot] = variable.isCaptured;
+    }
+    return captured;
+}
+
+template <typename T>
+void Resolver::declare(T const& node)
+{
+    declare(node.name);
+
+    if (_scopes.empty()) {
+        const_cast<T&>(node).resolve(-1, globalSlot(node.name.lexeme));
+    }
+    else {
+        // Declarations always land in the innermost scope.
+        const_cast<T&>(node).resolve(0, _scopes.back().variables.at(node.name.lexeme).slot);
+    }
+}
+
 void Resolver::declare(Token const& name)
 {
     if (_scopes.empty()) {
         return;
     }
 
-    auto& scope = _scopes.back();
+    auto& scope = _scopes.back().variables;
 
     if (scope.find(name.lexeme) != scope.end()) {
         _lox->error(name, "Already a variable with this name in this scope.");
+        return;
     }
 
-    scope.emplace(name.lexeme, false);
+    // Slots are handed out in declaration order, which is also the order in
+    // which the interpreter defines them at runtime.
+    scope.emplace(name.lexeme, Variable{false, static_cast<int>(scope.size())});
 }
 
 void Resolver::define(Token const& name)
 {
     if (!_scopes.empty()) {
-        _scopes.back()[name.lexeme] = true;
+        _scopes.back().variables.at(name.lexeme).isDefined = true;
     }
 }
 
-int Resolver::resolveLocal(Token const& name)
+template <typename T>
+void Resolver::resolveLocal(T const& node, Token const& name)
 {
     int depth = 0;
     for (auto i = _scopes.rbegin(); i != _scopes.rend(); ++i, ++depth) {
-        auto& scope = *i;
-        if (scope.find(name.lexeme) != scope.end()) {
-            return depth;
+        auto& scope = i->variables;
+        if (auto it = scope.find(name.lexeme); it != scope.end()) {
+            const_cast<T&>(node).resolve(depth, it->second.slot);
+            capture(*i, it->second);
+            return;
         }
     }
 
-    return -1; // global
+    // Not found. Assume it is global.
+    const_cast<T&>(node).resolve(-1, globalSlot(name.lexeme));
 }
 
 void Resolver::resolveFunction(FunStmt const& stmt, FunctionType type)
 {
     auto enclosingFunction = _currentFunction;
     _currentFunction = type;
+    _functionDepth++;
 
-    beginScope();
+    // Methods find the instance they are called on in the first slot.
+    auto& scope = beginScope();
+    if (type == FunctionType::METHOD || type == FunctionType::INITIALIZER) {
+        scope.variables.emplace("this", Variable{true, 0});
+    }
     for (auto const& param : stmt.params) {
         declare(param);
         define(param);
     }
     resolve(stmt.body);
+    stmt.frameSize = _scopes.back().variables.size();
+    stmt.captured = captures();
     endScope();
 
+    _functionDepth--;
     _currentFunction = enclosingFunction;
 }
 
@@ -92,6 +156,7 @@ void Resolver::visit(BlockStmt const& stmt)
 {
     beginScope();
     resolve(stmt.stmts);
+    stmt.captured = captures();
     endScope();
 }
 
@@ -137,7 +202,7 @@ void Resolver::visit(PrintStmt const& stmt)
 
 void Resolver::visit(VarStmt const& stmt)
 {
-    declare(stmt.name);
+    declare(stmt);
     if (stmt.initializer) {
         resolve(*stmt.initializer);
     }
@@ -146,7 +211,7 @@ void Resolver::visit(VarStmt const& stmt)
 
 void Resolver::visit(FunStmt const& stmt)
 {
-    declare(stmt.name);
+    declare(stmt);
     define(stmt.name);
 
     resolveFunction(stmt, FunctionType::FUNCTION);
@@ -157,7 +222,7 @@ void Resolver::visit(ClassStmt const& stmt)
     auto enclosingClass = _currentClass;
     _currentClass = stmt.superclass ? ClassType::SUBCLASS : ClassType::CLASS;
 
-    declare(stmt.name);
+    declare(stmt);
     define(stmt.name);
 
     if (stmt.superclass) {
@@ -168,22 +233,17 @@ void Resolver::visit(ClassStmt const& stmt)
         resolve(*stmt.superclass);
 
         auto& superScope = beginScope();
-        superScope.emplace("super", true);
+        superScope.variables.emplace("super", Variable{true, 0});
     }
 
-    auto& thisScope = beginScope();
-    thisScope.emplace("this", true);
-
-    for (auto const& method : stmt.methods) {
+    for (auto method : stmt.methods) {
         auto type = FunctionType::METHOD;
-        if (method.name.lexeme == "init") {
+        if (method->name.lexeme == "init") {
             type = FunctionType::INITIALIZER;
         }
-        resolveFunction(method, type);
+        resolveFunction(*method, type);
     }
 
-    endScope(); // end thisScope
-
     if (stmt.superclass) {
         endScope(); // end superScope
     }
@@ -194,7 +254,7 @@ void Resolver::visit(ClassStmt const& stmt)
 void Resolver::visit(AssignExpr const& expr)
 {
     resolve(expr.value);
-    const_cast<AssignExpr&>(expr).resolve(resolveLocal(expr.name));
+    resolveLocal(expr, expr.name);
 }
 
 void Resolver::visit(BinaryExpr const& expr)
@@ -244,7 +304,7 @@ void Resolver::visit(ThisExpr const& expr)
         _lox->error(expr.keyword, "Can't use 'this' outside of a class.");
     }
 
-    const_cast<ThisExpr&>(expr).resolve(resolveLocal(expr.keyword));
+    resolveLocal(expr, expr.keyword);
 }
 
 void Resolver::visit(SuperExpr const& expr)
@@ -256,7 +316,14 @@ void Resolver::visit(SuperExpr const& expr)
         _lox->error(expr.keyword, "Can't use 'super' in a class with no superclass.");
     }
 
-    const_cast<SuperExpr&>(expr).resolve(resolveLocal(expr.keyword));
+    resolveLocal(expr, expr.keyword);
+
+    // The instance to call the method on is "this" of the method, which is
+    // in the scope right inside that of "super".
+    if (expr.depth() > 0) {
+        auto& scope = _scopes[_scopes.size() - expr.depth()];
+        capture(scope, scope.variables.at("this"));
+    }
 }
 
 void Resolver::visit(UnaryExpr const& expr)
@@ -267,16 +334,15 @@ void Resolver::visit(UnaryExpr const& expr)
 void Resolver::visit(VariableExpr const& expr)
 {
     if (!_scopes.empty()) {
-        auto& scope = _scopes.back();
+        auto& scope = _scopes.back().variables;
         if (auto it = scope.find(expr.name.lexeme); it != scope.end()) {
-            auto isDefined = it->second;
-            if (!isDefined) {
+            if (!it->second.isDefined) {
                 _lox->error(expr.name, "Can't read local variable in its own initializer.");
             }
         }
     }
 
-    const_cast<VariableExpr&>(expr).resolve(resolveLocal(expr.name));
+    resolveLocal(expr, expr.name);
 }
 
 } // namespace cloxx
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include "ast/Expr.hpp"
 #include "ast/Stmt.hpp"
@@ -16,6 +18,12 @@ public:
 
     void resolve(std::vector<Stmt> const& stmts);
 
+    // Returns the global slot for the given name, allocating a new one on first use.
+    int globalSlot(std::string const& name);
+
+    // Names of the global slots, indexed by slot
+    std::vector<std::string> globalNames() const;
+
 private:
     enum class FunctionType {
         NONE,
@@ -33,14 +41,34 @@ private:
     void resolve(Stmt const& stmt);
     void resolve(Expr const& expr);
 
-    using Scope = std::map<std::string, /*isDefined*/ bool>;
+    struct Variable {
+        bool isDefined;
+        int slot;
+        bool isCaptured = false;
+    };
+    struct Scope {
+        std::map<std::string, Variable> variables;
+
+        // How many functions the scope is nested in
+        int functionDepth;
+    };
     Scope& beginScope();
     void endScope();
 
+    // Notes the variable as captured if the innermost function is nested in
+    // a function other than the one the scope belongs to.
+    void capture(Scope const& scope, Variable& variable);
+
+    // Which slots of the innermost scope closures capture
+    std::vector<bool> captures() const;
+
+    template <typename T>
+    void declare(T const& node);
     void declare(Token const& name);
     void define(Token const& name);
 
-    int resolveLocal(Token const& name);
+    template <typename T>
+    void resolveLocal(T const& node, Token const& name);
     void resolveFunction(FunStmt const& stmt, FunctionType functionType);
 
     // StmtVisitor
@@ -72,6 +100,8 @@ private:
     Lox* const _lox;
 
     std::vector<Scope> _scopes;
+    int _functionDepth = 0;
+    std::map<std::string, int> _globalSlots;
     FunctionType _currentFunction = FunctionType::NONE;
     ClassType _currentClass = ClassType::NONE;
 };
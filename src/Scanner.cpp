@@ -1,5 +1,6 @@
 #include "Scanner.hpp"
 
+#include "GC.hpp"
 #include "Lox.hpp"
 
 namespace cloxx {
@@ -26,7 +27,8 @@ std::map<std::string, Token::Type> const Scanner::_keywords = {
     {"this", Token::THIS}, {"true", Token::TRUE},   {"var", Token::VAR},       {"while", Token::WHILE},
 };
 
-Scanner::Scanner(Lox* const lox, std::string source) : _lox{lox}, _source{std::move(source)}
+Scanner::Scanner(Lox* const lox, GarbageCollector* gc, std::string source)
+    : _lox{lox}, _gc{gc}, _source{std::move(source)}
 {}
 
 std::vector<Token> Scanner::scanTokens()
@@ -37,7 +39,7 @@ std::vector<Token> Scanner::scanTokens()
         scanToken();
     }
 
-    _tokens.emplace_back(Token::END_OF_FILE, "", nullptr, _line);
+    _tokens.emplace_back(Token::END_OF_FILE, "", Value{}, _line);
     return _tokens;
 }
 
@@ -140,10 +142,10 @@ char Scanner::advance()
 
 void Scanner::addToken(Token::Type type)
 {
-    addToken(type, nullptr);
+    addToken(type, Value{});
 }
 
-void Scanner::addToken(Token::Type type, std::shared_ptr<LoxObject> const& literal)
+void Scanner::addToken(Token::Type type, Value const& literal)
 {
     auto lexeme = _source.substr(_start, _current - _start);
     _tokens.emplace_back(type, std::move(lexeme), literal, _line);
@@ -194,7 +196,11 @@ void Scanner::string()
 
     // Trim the surrounding quotes.
     auto value = _source.substr(_start + 1, _current - _start - 2);
-    addToken(Token::STRING, std::make_shared<LoxString>(std::move(value)));
+    auto str = _gc->intern(std::move(value));
+
+    // Literals live in the AST, which the collector cannot see.
+    _gc->pin(str);
+    addToken(Token::STRING, str);
 }
 
 void Scanner::number()
@@ -213,7 +219,7 @@ void Scanner::number()
     }
 
     auto value = std::stod(_source.substr(_start, _current - _start));
-    addToken(Token::NUMBER, std::make_shared<LoxNumber>(value));
+    addToken(Token::NUMBER, toLoxNumber(value));
 }
 
 void Scanner::identifier()
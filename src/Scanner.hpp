@@ -8,10 +8,11 @@
 namespace cloxx {
 
 class Lox;
+class GarbageCollector;
 
 class Scanner {
 public:
-    explicit Scanner(Lox* lox, std::string source);
+    explicit Scanner(Lox* lox, GarbageCollector* gc, std::string source);
 
     std::vector<Token> scanTokens();
 
@@ -20,7 +21,7 @@ private:
     void scanToken();
     char advance();
     void addToken(Token::Type type);
-    void addToken(Token::Type type, std::shared_ptr<LoxObject> const& literal);
+    void addToken(Token::Type type, Value const& literal);
     bool match(char expected);
     char peek() const;
     char peekNext() const;
@@ -31,6 +32,7 @@ private:
     static std::map<std::string, Token::Type> const _keywords;
 
     Lox* const _lox;
+    GarbageCollector* const _gc;
 
     std::string _source;
 
@@ -0,0 +1,21 @@
+#include "Shape.hpp"
+
+#include "Assert.hpp"
+
+namespace cloxx {
+
+Shape* Shape::withField(std::string const& name)
+{
+    LOX_ASSERT(find(name) == notFound);
+
+    auto& shape = _transitions[name];
+    if (!shape) {
+        shape = std::make_unique<Shape>();
+        shape->_names.reserve(_names.size() + 1);
+        shape->_names = _names;
+        shape->_names.push_back(name);
+    }
+    return shape.get();
+}
+
+} // namespace cloxx
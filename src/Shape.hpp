@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cloxx {
+
+// Shape describes the layout of the fields of instances: which slot holds the
+// value of each field. Instances that got the same fields in the same order
+// share their shape. Shapes form a tree of transitions from the empty shape,
+// one per field added. They are owned by the collector and never freed, so
+// their addresses can be cached.
+class Shape {
+public:
+    static constexpr size_t notFound = static_cast<size_t>(-1);
+
+    Shape() = default;
+
+    Shape(Shape const&) = delete;
+    Shape& operator=(Shape const&) = delete;
+
+    // Returns the slot of the field, or notFound.
+    size_t find(std::string_view name) const
+    {
+        for (size_t slot = 0; slot < _names.size(); slot++) {
+            if (_names[slot] == name) {
+                return slot;
+            }
+        }
+        return notFound;
+    }
+
+    // Returns the shape with `name` added in the next slot.
+    Shape* withField(std::string const& name);
+
+    size_t fieldCount() const
+    {
+        return _names.size();
+    }
+
+    std::string const& fieldName(size_t slot) const
+    {
+        return _names[slot];
+    }
+
+private:
+    std::vector<std::string> _names;
+    std::unordered_map<std::string, std::unique_ptr<Shape>> _transitions;
+};
+
+} // namespace cloxx
@@ -0,0 +1,24 @@
+#include "SlabAllocator.hpp"
+
+namespace cloxx {
+
+SlabAllocator::~SlabAllocator()
+{
+    for (auto slab : _slabs) {
+        ::operator delete(slab);
+    }
+}
+
+void SlabAllocator::refill(size_t index)
+{
+    _slabs.reserve(_slabs.size() + 1);
+    auto slab = static_cast<char*>(::operator new(slabSize));
+    _slabs.push_back(slab);
+
+    auto slotSize = slotSizeOf(index);
+    auto& sizeClass = _sizeClasses[index];
+    sizeClass.bump = slab;
+    sizeClass.end = slab + slabSize / slotSize * slotSize;
+}
+
+} // namespace cloxx
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace cloxx {
+
+// SlabAllocator hands out memory for heap objects from large slabs, with a
+// separate set of slabs and a free list for every 16-byte size class. Each
+// kind of object has its own size, so objects of one kind end up next to each
+// other. Allocation pops the free list or bumps a pointer; freed memory is
+// pushed back to the free list and reused, but never returned to the system.
+// Sizes beyond the largest class go to operator new.
+class SlabAllocator {
+public:
+    SlabAllocator() = default;
+    ~SlabAllocator();
+
+    SlabAllocator(SlabAllocator const&) = delete;
+    SlabAllocator& operator=(SlabAllocator const&) = delete;
+
+    void* allocate(size_t size)
+    {
+        if (size > maxSlotSize) {
+            return ::operator new(size);
+        }
+
+        auto index = sizeClassOf(size);
+        auto& sizeClass = _sizeClasses[index];
+        if (auto slot = sizeClass.freeList) {
+            sizeClass.freeList = slot->next;
+            return slot;
+        }
+        if (sizeClass.bump == sizeClass.end) {
+            refill(index);
+        }
+        auto slot = sizeClass.bump;
+        sizeClass.bump += slotSizeOf(index);
+        return slot;
+    }
+
+    void deallocate(void* memory, size_t size)
+    {
+        if (size > maxSlotSize) {
+            ::operator delete(memory);
+            return;
+        }
+
+        auto& sizeClass = _sizeClasses[sizeClassOf(size)];
+        auto slot = static_cast<FreeSlot*>(memory);
+        slot->next = sizeClass.freeList;
+        sizeClass.freeList = slot;
+    }
+
+private:
+    static constexpr size_t granularity = 16;
+    static constexpr size_t maxSlotSize = 256;
+    static constexpr size_t slabSize = 64 * 1024;
+
+    static constexpr size_t sizeClassOf(size_t size)
+    {
+        return (size - 1) / granularity;
+    }
+
+    static constexpr size_t slotSizeOf(size_t sizeClass)
+    {
+        return (sizeClass + 1) * granularity;
+    }
+
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    struct SizeClass {
+        FreeSlot* freeList = nullptr;
+        char* bump = nullptr;
+        char* end = nullptr;
+    };
+
+    void refill(size_t index);
+
+    std::array<SizeClass, maxSlotSize / granularity> _sizeClasses;
+    std::vector<void*> _slabs;
+};
+
+} // namespace cloxx
@@ -0,0 +1,23 @@
+#include "StringTable.hpp"
+
+#include "LoxObject.hpp"
+
+namespace cloxx {
+
+LoxString* StringTable::find(std::string_view value, size_t hash) const
+{
+    auto [begin, end] = _strings.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+        if (it->second->value() == value) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+void StringTable::insert(LoxString* str)
+{
+    _strings.emplace(str->hash(), str);
+}
+
+} // namespace cloxx
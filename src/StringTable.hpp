@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string_view>
+#include <unordered_map>
+
+namespace cloxx {
+
+class LoxString;
+
+// StringTable canonicalizes LoxString values so that two strings with the same
+// contents are always the same object. It doesn't keep strings alive; the
+// collector drops the entries of dead strings before it frees them.
+class StringTable {
+public:
+    LoxString* find(std::string_view value, size_t hash) const;
+    void insert(LoxString* str);
+
+    // Drops the entries of strings the collector is about to free.
+    template <typename Predicate>
+    size_t removeIf(Predicate const& isDead)
+    {
+        size_t removedCount = 0;
+        for (auto it = _strings.begin(); it != _strings.end();) {
+            if (isDead(it->second)) {
+                it = _strings.erase(it);
+                removedCount += 1;
+            }
+            else {
+                ++it;
+            }
+        }
+        return removedCount;
+    }
+
+private:
+    std::unordered_multimap<size_t, LoxString*> _strings;
+};
+
+} // namespace cloxx
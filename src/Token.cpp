@@ -67,7 +67,7 @@ char const* getTokenName(Token::Type tokenType)
 } // namespace
 #endif
 
-Token::Token(Type type, std::string lexeme, std::shared_ptr<LoxObject> const& literal, size_t line)
+Token::Token(Type type, std::string lexeme, Value const& literal, size_t line)
     : type{type}, lexeme{std::move(lexeme)}, literal{literal}, line{line}
 {}
 
@@ -77,8 +77,8 @@ std::string Token::toString() const
     std::ostringstream oss;
 
     oss << getTokenName(type) << " ";
-    if (literal) {
-        oss << literal->toString() << " ";
+    if (!literal.isNil()) {
+        oss << literal.toString() << " ";
     }
     oss << line;
 
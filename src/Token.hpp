@@ -1,9 +1,8 @@
 #pragma once
 
-#include <memory>
 #include <string>
 
-#include "LoxObject.hpp"
+#include "Value.hpp"
 
 namespace cloxx {
 
@@ -59,7 +58,7 @@ struct Token {
         END_OF_FILE
     };
 
-    Token(Type type, std::string lexeme, std::shared_ptr<LoxObject> const& literal, size_t line);
+    Token(Type type, std::string lexeme, Value const& literal, size_t line);
 
 #ifndef NDEBUG
     std::string toString() const;
@@ -67,7 +66,7 @@ struct Token {
 
     Type const type;
     std::string const lexeme;
-    std::shared_ptr<LoxObject> const literal;
+    Value const literal;
     size_t const line;
 };
 
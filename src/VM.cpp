@@ -0,0 +1,669 @@
+#include "VM.hpp"
+
+#include <algorithm>
+#include <iostream> // for print statement
+#include <map>
+#include <new>
+
+#include "Assert.hpp"
+#include "Compiler.hpp"
+#include "Environment.hpp"
+#include "Lox.hpp"
+#include "LoxClass.hpp"
+#include "LoxFunction.hpp"
+#include "LoxInstance.hpp"
+#include "RuntimeError.hpp"
+
+// Labels as values let every instruction jump straight to the next one, which
+// predicts better than going back to a single switch.
+#if defined(__GNUC__)
+#define CLOXX_COMPUTED_GOTO 1
+#else
+#define CLOXX_COMPUTED_GOTO 0
+#endif
+
+namespace cloxx {
+
+namespace {
+// Capacity of the value stack. It is only committed as it is used.
+size_t const stackSize = 1024 * 1024;
+
+size_t const maxFrames = 64 * 1024;
+
+void checkNumberOperand(Token const& op, Value const& operand)
+{
+    if (!operand.isNumber()) {
+        throw RuntimeError{op, "Operand must be a number."};
+    }
+}
+
+void checkNumberOperands(Token const& op, Value const& left, Value const& right)
+{
+    if (!left.isNumber() || !right.isNumber()) {
+        throw RuntimeError{op, "Operands must be numbers."};
+    }
+}
+
+void checkArity(size_t arity, size_t argCount, Token const& paren)
+{
+    if (argCount != arity) {
+        throw RuntimeError(paren, "Expected " + std::to_string(arity) + " arguments but got " +
+                                      std::to_string(argCount) + ".");
+    }
+}
+} // namespace
+
+Value VM::FunctionExecutor::operator()(Environment* environment, std::vector<Stmt> const& /*body*/) const
+{
+    auto& chunk = *info->chunk;
+    if (!vm->hasRoomFor(chunk, vm->_stackTop)) {
+        throw RuntimeError{info->declaration.name, "Stack overflow."};
+    }
+
+    // The arguments move to their slots, and the environment the function
+    // closes over is the one enclosing theirs.
+    auto slots = vm->_stackTop;
+    for (size_t slot = 0; slot < chunk.argumentSlots; slot++) {
+        slots[slot] = environment->getAt(0, slot);
+    }
+    vm->_stackTop = slots + chunk.argumentSlots;
+    return vm->run(chunk, environment->enclosing());
+}
+
+VM::VM(Lox* lox, GarbageCollector* gc, PropertyCacheStats* cacheStats)
+    : _lox{lox}, _gc{gc}, _cacheStats{cacheStats}, _globals{gc->root()},
+      _stack{static_cast<Value*>(::operator new(stackSize * sizeof(Value)))}, _stackEnd{_stack + stackSize}, _stackTop{_stack}
+{
+    _frames.reserve(maxFrames);
+    _gc->addRootSet(this);
+}
+
+VM::~VM()
+{
+    _gc->removeRootSet(this);
+    ::operator delete(_stack);
+}
+
+void VM::interpret(std::vector<Stmt> const& stmts)
+{
+    LOX_ASSERT(_frames.empty() && _stackTop == _stack);
+
+    auto chunk = Compiler::compile(stmts);
+    try {
+        run(*chunk, _globals);
+    }
+    catch (RuntimeError& error) {
+        _lox->runtimeError(error);
+    }
+
+    // Functions declared in the statements refer to their bytecode.
+    if (!chunk->functions.empty()) {
+        _chunks.push_back(std::move(chunk));
+    }
+}
+
+bool VM::hasRoomFor(Chunk const& chunk, Value const* slots) const
+{
+    return _frames.size() < maxFrames &&
+           chunk.localSlots + chunk.maxStackDepth < static_cast<size_t>(_stackEnd - slots);
+}
+
+Value VM::run(Chunk const& chunk, Environment* environment)
+{
+    auto const entryFrameCount = _frames.size();
+    auto const entryStackTop = _stackTop - chunk.argumentSlots;
+    std::fill(_stackTop, entryStackTop + chunk.localSlots, makeLoxNil());
+    _stackTop = entryStackTop + chunk.localSlots;
+    _frames.push_back({&chunk, chunk.code.data(), environment, entryStackTop, nullptr});
+
+    // The state of the innermost frame is kept in locals. Whatever may reach
+    // a safe point or call back into the VM must store them first. Computed
+    // gotos don't run destructors, so instructions must not leave objects
+    // that own memory in scope.
+    auto frame = &_frames.back();
+    auto code = frame->chunk;
+    auto ip = frame->ip;
+    auto env = frame->environment;
+    auto slots = frame->slots;
+    auto sp = _stackTop;
+
+#if CLOXX_COMPUTED_GOTO
+#define CLOXX_OPCODE_LABEL(name) &&op_##name,
+    static void* const dispatchTable[] = {CLOXX_OPCODES(CLOXX_OPCODE_LABEL)};
+#undef CLOXX_OPCODE_LABEL
+#define DISPATCH() goto* dispatchTable[*ip++]
+#define CASE(name) op_##name:
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case OpCode::name:
+#endif
+
+#define TOKEN() (code->tokens[readU32(ip)])
+#define CACHE() (code->caches[readU32(ip)])
+
+// Continues with the innermost frame and the stack as left by a call or return.
+#define LOAD_FRAME()                                                                                                   \
+    do {                                                                                                               \
+        frame = &_frames.back();                                                                                       \
+        code = frame->chunk;                                                                                           \
+        ip = frame->ip;                                                                                                \
+        env = frame->environment;                                                                                      \
+        slots = frame->slots;                                                                                          \
+        sp = _stackTop;                                                                                                \
+    } while (false)
+
+    try {
+#if CLOXX_COMPUTED_GOTO
+        DISPATCH();
+#else
+    dispatch:
+        switch (static_cast<OpCode>(*ip++)) {
+#endif
+
+        CASE(CONSTANT)
+        {
+            *sp++ = code->constants[readU32(ip)];
+            DISPATCH();
+        }
+
+        CASE(NIL)
+        {
+            *sp++ = makeLoxNil();
+            DISPATCH();
+        }
+
+        CASE(TRUE)
+        {
+            *sp++ = toLoxBoolean(true);
+            DISPATCH();
+        }
+
+        CASE(FALSE)
+        {
+            *sp++ = toLoxBoolean(false);
+            DISPATCH();
+        }
+
+        CASE(POP)
+        {
+            sp--;
+            DISPATCH();
+        }
+
+        CASE(DEFINE_LOCAL)
+        {
+            slots[readU32(ip)] = *--sp;
+            DISPATCH();
+        }
+
+        CASE(DEFINE_CAPTURED)
+        {
+            auto slot = readU32(ip);
+            env->define(slot, *--sp);
+            DISPATCH();
+        }
+
+        CASE(DEFINE_GLOBAL)
+        {
+            auto slot = readU32(ip);
+            _globals->define(slot, *--sp);
+            DISPATCH();
+        }
+
+        CASE(GET_LOCAL)
+        {
+            auto slot = readU32(ip);
+            *sp++ = slots[slot];
+            DISPATCH();
+        }
+
+        CASE(SET_LOCAL)
+        {
+            slots[readU32(ip)] = sp[-1];
+            DISPATCH();
+        }
+
+        CASE(GET_CAPTURED)
+        {
+            auto depth = readU32(ip);
+            auto slot = readU32(ip);
+            *sp++ = env->getAt(depth, slot);
+            DISPATCH();
+        }
+
+        CASE(SET_CAPTURED)
+        {
+            auto depth = readU32(ip);
+            auto slot = readU32(ip);
+            env->assignAt(depth, slot, sp[-1]);
+            DISPATCH();
+        }
+
+        CASE(GET_GLOBAL)
+        {
+            auto slot = readU32(ip);
+            *sp++ = _globals->get(slot, TOKEN());
+            DISPATCH();
+        }
+
+        CASE(SET_GLOBAL)
+        {
+            auto slot = readU32(ip);
+            _globals->assign(slot, TOKEN(), sp[-1]);
+            DISPATCH();
+        }
+
+        CASE(GET_PROPERTY)
+        {
+            auto& name = TOKEN();
+            if (!sp[-1].isObject(LoxObject::Kind::INSTANCE)) {
+                throw RuntimeError(name, "Only instances have properties.");
+            }
+            sp[-1] = static_cast<LoxInstance*>(sp[-1].asObject())->get(name, CACHE(), _cacheStats);
+            DISPATCH();
+        }
+
+        CASE(CHECK_FIELDS)
+        {
+            auto& name = TOKEN();
+            if (!sp[-1].isObject(LoxObject::Kind::INSTANCE)) {
+                throw RuntimeError(name, "Only instances have fields.");
+            }
+            DISPATCH();
+        }
+
+        CASE(SET_PROPERTY)
+        {
+            auto& name = TOKEN();
+            static_cast<LoxInstance*>(sp[-2].asObject())->set(name, sp[-1], CACHE(), _cacheStats);
+            sp[-2] = sp[-1];
+            sp--;
+            DISPATCH();
+        }
+
+        CASE(GET_SUPER)
+        {
+            auto depth = readU32(ip);
+            auto& method = TOKEN();
+            auto instance = static_cast<LoxInstance*>(sp[-1].asObject());
+            sp[-1] = findSuperMethod(env, depth, method)->bind(instance);
+            DISPATCH();
+        }
+
+        CASE(GET_METHOD)
+        {
+            auto& name = TOKEN();
+            if (!sp[-1].isObject(LoxObject::Kind::INSTANCE)) {
+                throw RuntimeError(name, "Only instances have properties.");
+            }
+            auto instance = static_cast<LoxInstance*>(sp[-1].asObject());
+            if (auto method = instance->getMethod(name, CACHE(), _cacheStats, sp[-1])) {
+                sp[-1] = method;
+                *sp++ = instance;
+            }
+            else {
+                *sp++ = makeLoxNil();
+            }
+            DISPATCH();
+        }
+
+        CASE(GET_SUPER_METHOD)
+        {
+            auto depth = readU32(ip);
+            auto& method = TOKEN();
+            sp[0] = sp[-1];
+            sp[-1] = findSuperMethod(env, depth, method);
+            sp++;
+            DISPATCH();
+        }
+
+        CASE(EQUAL)
+        {
+            sp[-2] = toLoxBoolean(sp[-2].equals(sp[-1]));
+            sp--;
+            DISPATCH();
+        }
+
+        CASE(NOT_EQUAL)
+        {
+            sp[-2] = toLoxBoolean(!sp[-2].equals(sp[-1]));
+            sp--;
+            DISPATCH();
+        }
+
+#define CLOXX_NUMBER_BINARY(name, makeValue, op)                                                                       \
+    CASE(name)                                                                                                         \
+    {                                                                                                                  \
+        auto& token = TOKEN();                                                                                         \
+        checkNumberOperands(token, sp[-2], sp[-1]);                                                                    \
+        sp[-2] = makeValue(sp[-2].asNumber() op sp[-1].asNumber());                                                    \
+        sp--;                                                                                                          \
+        DISPATCH();                                                                                                    \
+    }
+
+        CLOXX_NUMBER_BINARY(GREATER, toLoxBoolean, >)
+        CLOXX_NUMBER_BINARY(GREATER_EQUAL, toLoxBoolean, >=)
+        CLOXX_NUMBER_BINARY(LESS, toLoxBoolean, <)
+        CLOXX_NUMBER_BINARY(LESS_EQUAL, toLoxBoolean, <=)
+        CLOXX_NUMBER_BINARY(SUBTRACT, toLoxNumber, -)
+        CLOXX_NUMBER_BINARY(MULTIPLY, toLoxNumber, *)
+        CLOXX_NUMBER_BINARY(DIVIDE, toLoxNumber, /)
+#undef CLOXX_NUMBER_BINARY
+
+        CASE(ADD)
+        {
+            auto& token = TOKEN();
+            auto& left = sp[-2];
+            auto& right = sp[-1];
+            if (left.isNumber() && right.isNumber()) {
+                left = toLoxNumber(left.asNumber() + right.asNumber());
+            }
+            else if (left.isObject(LoxObject::Kind::STRING) && right.isObject(LoxObject::Kind::STRING)) {
+                left = _gc->concatenate(static_cast<LoxString&>(*left.asObject()),
+                                        static_cast<LoxString&>(*right.asObject()));
+            }
+            else {
+                throw RuntimeError(token, "Operands must be two numbers or two strings.");
+            }
+            sp--;
+            DISPATCH();
+        }
+
+        CASE(NOT)
+        {
+            sp[-1] = toLoxBoolean(!sp[-1].isTruthy());
+            DISPATCH();
+        }
+
+        CASE(NEGATE)
+        {
+            auto& token = TOKEN();
+            checkNumberOperand(token, sp[-1]);
+            sp[-1] = toLoxNumber(-sp[-1].asNumber());
+            DISPATCH();
+        }
+
+        CASE(PRINT)
+        {
+            std::cout << (--sp)->toString() << '\n';
+            DISPATCH();
+        }
+
+        CASE(JUMP)
+        {
+            auto offset = readU32(ip);
+            ip += offset;
+            DISPATCH();
+        }
+
+        CASE(JUMP_IF_FALSE)
+        {
+            auto offset = readU32(ip);
+            if (!sp[-1].isTruthy()) {
+                ip += offset;
+            }
+            DISPATCH();
+        }
+
+        CASE(JUMP_IF_TRUE)
+        {
+            auto offset = readU32(ip);
+            if (sp[-1].isTruthy()) {
+                ip += offset;
+            }
+            DISPATCH();
+        }
+
+        CASE(POP_JUMP_IF_FALSE)
+        {
+            auto offset = readU32(ip);
+            if (!(--sp)->isTruthy()) {
+                ip += offset;
+            }
+            DISPATCH();
+        }
+
+        CASE(LOOP)
+        {
+            auto offset = readU32(ip);
+            ip -= offset;
+            _stackTop = sp;
+            _gc->maybeCollect();
+            DISPATCH();
+        }
+
+        CASE(CALL)
+        {
+            auto argCount = readU32(ip);
+            auto& paren = TOKEN();
+            frame->ip = ip;
+            _stackTop = sp;
+            callValue(sp - argCount - 1, nullptr, argCount, paren);
+            LOAD_FRAME();
+            DISPATCH();
+        }
+
+        CASE(INVOKE)
+        {
+            auto argCount = readU32(ip);
+            auto& paren = TOKEN();
+            auto callee = sp - argCount - 2;
+            LoxInstance* receiver = nullptr;
+            if (callee[1].isNil()) {
+                // A field, called like any other value
+                std::copy(callee + 2, sp, callee + 1);
+                sp--;
+            }
+            else {
+                receiver = static_cast<LoxInstance*>(callee[1].asObject());
+            }
+            frame->ip = ip;
+            _stackTop = sp;
+            callValue(callee, receiver, argCount, paren);
+            LOAD_FRAME();
+            DISPATCH();
+        }
+
+        CASE(CLOSURE)
+        {
+            *sp++ = makeFunction(code->functions[readU32(ip)], env);
+            DISPATCH();
+        }
+
+        CASE(CLASS)
+        {
+            auto& info = code->classes[readU32(ip)];
+            if (info.superclass) {
+                sp[-1] = makeClass(info, *code, env, sp[-1]);
+            }
+            else {
+                *sp++ = makeClass(info, *code, env, makeLoxNil());
+            }
+            DISPATCH();
+        }
+
+        CASE(PUSH_SCOPE)
+        {
+            env = _gc->create<Environment>(_gc, env, readU32(ip));
+            frame->environment = env;
+            _stackTop = sp;
+            _gc->maybeCollect();
+            DISPATCH();
+        }
+
+        CASE(POP_SCOPE)
+        {
+            env = env->enclosing();
+            frame->environment = env;
+            DISPATCH();
+        }
+
+        CASE(RETURN)
+        {
+            auto result = *--sp;
+            if (frame->initialized) {
+                result = frame->initialized;
+            }
+
+            _stackTop = slots;
+            _frames.pop_back();
+            if (_frames.size() == entryFrameCount) {
+                return result;
+            }
+
+            slots[-1] = result;
+            LOAD_FRAME();
+            DISPATCH();
+        }
+
+#if !CLOXX_COMPUTED_GOTO
+        }
+#endif
+    }
+    catch (...) {
+        _frames.resize(entryFrameCount);
+        _stackTop = entryStackTop;
+        throw;
+    }
+
+#undef LOAD_FRAME
+#undef CACHE
+#undef TOKEN
+#undef CASE
+#undef DISPATCH
+
+    LOX_ASSERT(false); // Every chunk ends with a return.
+    return makeLoxNil();
+}
+
+void VM::callValue(Value* callee, LoxInstance* receiver, size_t argCount, Token const& paren)
+{
+    // Functions compiled for this VM run in a new frame of the same loop, and
+    // so do the initializers of classes, whose instances are made here. The
+    // callee stays on the stack, which keeps it alive.
+    if (callee->isObject(LoxObject::Kind::FUNCTION)) {
+        auto function = static_cast<LoxFunction*>(callee->asObject());
+        if (function->proto().chunk) {
+            pushFrame(function, callee, receiver ? receiver : function->receiver(), argCount, paren);
+            return;
+        }
+    }
+    else if (callee->isObject(LoxObject::Kind::CLASS)) {
+        auto klass = static_cast<LoxClass*>(callee->asObject());
+        auto initializer = klass->findMethod("init");
+        if (!initializer) {
+            checkArity(0, argCount, paren);
+            *callee = _gc->create<LoxInstance>(_gc, klass);
+            _stackTop = callee + 1;
+            return;
+        }
+        if (initializer->proto().chunk) {
+            checkArity(initializer->arity(), argCount, paren);
+            pushFrame(initializer, callee, _gc->create<LoxInstance>(_gc, klass), argCount, paren);
+            return;
+        }
+    }
+
+    if (!callee->isObject() || !callee->asObject()->isCallable()) {
+        throw RuntimeError(paren, "Can only call functions and classes.");
+    }
+    auto callable = static_cast<LoxCallable*>(callee->asObject());
+    checkArity(callable->arity(), argCount, paren);
+
+    auto args = _stackTop - argCount;
+    std::vector<Value> argValues(args, args + argCount);
+    *callee = receiver ? static_cast<LoxFunction*>(callable)->invoke(receiver, argValues) : callable->call(argValues);
+    _stackTop = callee + 1;
+}
+
+void VM::pushFrame(LoxFunction* function, Value* callee, LoxInstance* receiver, size_t argCount, Token const& paren)
+{
+    auto& proto = function->proto();
+    checkArity(proto.arity, argCount, paren);
+
+    auto& chunk = *proto.chunk;
+    auto slots = callee + 1;
+    if (!hasRoomFor(chunk, slots)) {
+        throw RuntimeError(paren, "Stack overflow.");
+    }
+
+    // Methods get the instance in the first slot, ahead of the arguments,
+    // which is where invoking them already put it.
+    if (receiver) {
+        if (_stackTop - argCount == slots) {
+            std::copy_backward(slots, _stackTop, _stackTop + 1);
+        }
+        slots[0] = receiver;
+    }
+
+    std::fill(slots + chunk.argumentSlots, slots + chunk.localSlots, makeLoxNil());
+    _frames.push_back(
+        {&chunk, chunk.code.data(), function->closure(), slots, proto.isInitializer ? receiver : nullptr});
+    _stackTop = slots + chunk.localSlots;
+
+    // Like entering a block in the other backends, entering a function is a
+    // safe point, so that recursion without loops still collects. The new
+    // frame is rooted by now.
+    _gc->maybeCollect();
+}
+
+LoxFunction* VM::findSuperMethod(Environment* environment, size_t depth, Token const& name)
+{
+    // "super" occupies the only slot of its own environment.
+    auto& superclass = environment->getAt(depth, 0);
+    LOX_ASSERT(superclass.isObject(LoxObject::Kind::CLASS));
+
+    auto method = static_cast<LoxClass&>(*superclass.asObject()).findMethod(name.lexeme);
+    if (!method) {
+        throw RuntimeError(name, "Undefined property '" + name.lexeme + "'.");
+    }
+    return method;
+}
+
+LoxFunction* VM::makeFunction(FunctionInfo const& info, Environment* closure)
+{
+    if (!info.proto) {
+        info.proto = std::make_unique<FunctionProto>(info.declaration, info.isInitializer,
+                                                     FunctionExecutor{this, &info}, info.chunk.get());
+    }
+    return _gc->create<LoxFunction>(_gc, *info.proto, closure);
+}
+
+LoxClass* VM::makeClass(ClassInfo const& info, Chunk const& chunk, Environment* environment, Value superclassValue)
+{
+    LoxClass* superclass = nullptr;
+    if (info.superclass) {
+        if (!superclassValue.isObject(LoxObject::Kind::CLASS)) {
+            throw RuntimeError(*info.superclass, "Superclass must be a class.");
+        }
+        superclass = static_cast<LoxClass*>(superclassValue.asObject());
+    }
+
+    auto methodEnvironment = environment;
+    if (superclass) {
+        methodEnvironment = _gc->create<Environment>(_gc, environment);
+        methodEnvironment->define(0, superclass);
+    }
+
+    std::map<std::string, LoxFunction*> methods;
+    for (auto index : info.methods) {
+        auto& method = chunk.functions[index];
+        methods.emplace(method.declaration.name.lexeme, makeFunction(method, methodEnvironment));
+    }
+
+    return _gc->create<LoxClass>(_gc, info.name.lexeme, superclass, methods);
+}
+
+void VM::enumerateRoots(Traceable::Enumerator const& enumerator)
+{
+    for (auto value = _stack; value != _stackTop; value++) {
+        if (value->isObject()) {
+            enumerator.enumerate(*value->asObject());
+        }
+    }
+    for (auto& frame : _frames) {
+        enumerator.enumerate(*frame.environment);
+    }
+}
+
+} // namespace cloxx
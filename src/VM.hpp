@@ -0,0 +1,104 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "ast/Stmt.hpp"
+
+#include "Chunk.hpp"
+#include "GC.hpp"
+
+namespace cloxx {
+
+class Environment;
+class Lox;
+class LoxCallable;
+class LoxClass;
+class LoxFunction;
+class LoxInstance;
+struct PropertyCacheStats;
+
+// Runs statements compiled to bytecode by Compiler on a value stack. Each
+// call gets a frame of slots on the stack for its local variables, and an
+// environment only for scopes with variables that closures capture. Calls
+// from bytecode to functions and classes compiled for this VM push a frame
+// instead of recursing on the native stack.
+class VM : GarbageCollector::RootSet {
+public:
+    // Property lookups are counted into `cacheStats` unless it is null.
+    VM(Lox* lox, GarbageCollector* gc, PropertyCacheStats* cacheStats);
+    ~VM();
+
+    VM(VM const&) = delete;
+    VM& operator=(VM const&) = delete;
+
+    void interpret(std::vector<Stmt> const& stmts);
+
+private:
+    struct Frame {
+        Chunk const* chunk;
+        std::uint8_t const* ip;
+        Environment* environment;
+
+        // Local variables, right above the callee. The stack is cut back to
+        // here on return, with the result in place of the callee.
+        Value* slots;
+
+        // Set for calls to initializers the VM made itself, which return
+        // the instance whatever their body does. LoxFunction takes care of
+        // that for calls through it.
+        LoxInstance* initialized;
+    };
+
+    // Executor of the functions compiled for this VM, for calls from outside
+    // of it. Their arguments come in the environment LoxFunction made.
+    struct FunctionExecutor {
+        Value operator()(Environment* environment, std::vector<Stmt> const& body) const;
+
+        VM* vm;
+        FunctionInfo const* info;
+    };
+
+    // Runs `chunk` in a frame whose argument slots are already on top of
+    // the stack.
+    Value run(Chunk const& chunk, Environment* environment);
+
+    // Whether a new frame for `chunk` whose slots start at `slots` fits.
+    bool hasRoomFor(Chunk const& chunk, Value const* slots) const;
+
+    // Calls the callee at `callee` with the `argCount` arguments on top of
+    // the stack, invoking it on `receiver` if that is not null. Functions and
+    // classes compiled for this VM get a new frame to continue with; the
+    // result of anything else replaces the callee right away.
+    void callValue(Value* callee, LoxInstance* receiver, size_t argCount, Token const& paren);
+
+    // Pushes a frame for `function` on `receiver`, if any, whose arguments
+    // are on top of the stack right above the callee.
+    void pushFrame(LoxFunction* function, Value* callee, LoxInstance* receiver, size_t argCount, Token const& paren);
+
+    // Finds the method `super` refers to.
+    LoxFunction* findSuperMethod(Environment* environment, size_t depth, Token const& name);
+
+    LoxFunction* makeFunction(FunctionInfo const& info, Environment* closure);
+    LoxClass* makeClass(ClassInfo const& info, Chunk const& chunk, Environment* environment, Value superclassValue);
+
+    // GarbageCollector::RootSet
+    void enumerateRoots(Traceable::Enumerator const& enumerator) override;
+
+    Lox* const _lox;
+    GarbageCollector* const _gc;
+    PropertyCacheStats* const _cacheStats;
+    Environment* const _globals;
+
+    // Compiled top-level statements. Functions declared in them refer to
+    // their bytecode, so it is kept as long as the VM is.
+    std::vector<std::unique_ptr<Chunk>> _chunks;
+
+    // Neither ever grows, so pointers into them stay valid.
+    Value* const _stack;
+    Value* const _stackEnd;
+    Value* _stackTop;
+    std::vector<Frame> _frames;
+};
+
+} // namespace cloxx
@@ -0,0 +1,89 @@
+#include "Value.hpp"
+
+namespace cloxx {
+
+namespace {
+std::string numberToString(double value)
+{
+    auto str = std::to_string(value);
+
+    // Remove trailing zeros.
+    while (str.size() > 1) {
+        char c = str.back();
+        if (c == '0') {
+            str.pop_back();
+        }
+        else {
+            if (c == '.')
+                str.pop_back();
+            break;
+        }
+    }
+    return str;
+}
+} // namespace
+
+std::string Value::toString() const
+{
+    switch (_type) {
+    case NIL:
+        return "nil";
+    case BOOLEAN:
+        return _boolean ? "true" : "false";
+    case NUMBER:
+        return numberToString(_number);
+    case OBJECT:
+        return _object->toString();
+    case UNDEFINED:
+        break;
+    }
+
+    LOX_ASSERT(false);
+    return "";
+}
+
+bool Value::isTruthy() const
+{
+    switch (_type) {
+    case NIL:
+        return false;
+    case BOOLEAN:
+        return _boolean;
+    default:
+        return true;
+    }
+}
+
+bool Value::equals(Value const& value) const
+{
+    if (_type != value._type) {
+        return false;
+    }
+
+    switch (_type) {
+    case NIL:
+        return true;
+    case BOOLEAN:
+        return _boolean == value._boolean;
+    case NUMBER:
+        return _number == value._number;
+    case OBJECT:
+        if (_object == value._object) {
+            return true;
+        }
+        // Strings built by concatenation are not interned until compared.
+        if (isObject(LoxObject::Kind::STRING) && value.isObject(LoxObject::Kind::STRING)) {
+            auto& l = static_cast<LoxString const&>(*_object);
+            auto& r = static_cast<LoxString const&>(*value._object);
+            return l.length() == r.length() && &l.canonical() == &r.canonical();
+        }
+        return false;
+    case UNDEFINED:
+        break;
+    }
+
+    LOX_ASSERT(false);
+    return false;
+}
+
+} // namespace cloxx
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+
+#include "Assert.hpp"
+#include "LoxObject.hpp"
+
+namespace cloxx {
+
+// Value carries nil, booleans and numbers inline and only points to the heap
+// for the reference types (strings, functions, classes and instances).
+class Value {
+public:
+    enum Type : unsigned char {
+        NIL,
+        BOOLEAN,
+        NUMBER,
+        OBJECT,
+        UNDEFINED, // sentinel for global slots that have not been defined yet
+    };
+
+    Value() : _type{NIL}, _number{0}
+    {}
+
+    static Value undefined()
+    {
+        Value value;
+        value._type = UNDEFINED;
+        return value;
+    }
+
+    explicit Value(bool value) : _type{BOOLEAN}, _boolean{value}
+    {}
+
+    explicit Value(double value) : _type{NUMBER}, _number{value}
+    {}
+
+    Value(LoxObject* object) : _type{OBJECT}, _object{object}
+    {
+        LOX_ASSERT(_object);
+    }
+
+    Type type() const
+    {
+        return _type;
+    }
+
+    bool isNil() const
+    {
+        return _type == NIL;
+    }
+
+    bool isBoolean() const
+    {
+        return _type == BOOLEAN;
+    }
+
+    bool isNumber() const
+    {
+        return _type == NUMBER;
+    }
+
+    bool isObject() const
+    {
+        return _type == OBJECT;
+    }
+
+    bool isObject(LoxObject::Kind kind) const
+    {
+        return _type == OBJECT && _object->kind() == kind;
+    }
+
+    bool isUndefined() const
+    {
+        return _type == UNDEFINED;
+    }
+
+    bool asBoolean() const
+    {
+        LOX_ASSERT(isBoolean());
+        return _boolean;
+    }
+
+    double asNumber() const
+    {
+        LOX_ASSERT(isNumber());
+        return _number;
+    }
+
+    LoxObject* asObject() const
+    {
+        LOX_ASSERT(isObject());
+        return _object;
+    }
+
+    // Returns nullptr if the value doesn't refer to a heap object.
+    Traceable* toTraceable() const
+    {
+        return isObject() ? _object : nullptr;
+    }
+
+    std::string toString() const;
+    bool isTruthy() const;
+    bool equals(Value const& value) const;
+
+private:
+    Type _type;
+    union {
+        bool _boolean;
+        double _number;
+        LoxObject* _object;
+    };
+};
+
+// Helper functions.
+
+inline Value makeLoxNil()
+{
+    return Value{};
+}
+
+inline Value toLoxNumber(double value)
+{
+    return Value{value};
+}
+
+inline Value toLoxBoolean(bool value)
+{
+    return Value{value};
+}
+
+
+} // namespace cloxx
@@ -1,3 +1,5 @@
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <streambuf>
@@ -5,20 +7,214 @@
 #include "Assert.hpp"
 #include "GC.hpp"
 #include "Lox.hpp"
-#include "LoxObject.hpp"
 
 using namespace cloxx;
 
+namespace {
+struct Settings {
+    GCConfig gc;
+    Lox::Backend backend = Lox::Backend::INTERPRETER;
+    bool cacheStats = false;
+};
+
+void printUsage(char const* program)
+{
+    std::cerr << "Usage: " << program << " [options] filepath\n"
+              << "Options:\n"
+              << "  --backend=NAME           run the program with the tree-walking interpreter, the AST\n"
+              << "                           compiled to closures or the bytecode vm; NAME is interpreter,\n"
+              << "                           closure or vm (env: CLOXX_BACKEND, default: interpreter)\n"
+              << "  --cache-stats[=BOOL]     print how often property lookups hit their caches to stderr at\n"
+              << "                           exit, BOOL is 1, true, 0 or false (env: CLOXX_CACHE_STATS)\n"
+              << "  --gc-heap-growth=FACTOR  collect when the heap has grown by FACTOR (>= 1) since the last\n"
+              << "                           collection (env: CLOXX_GC_HEAP_GROWTH, default: 2)\n"
+              << "  --gc-min-heap=BYTES      never collect before the heap reaches BYTES\n"
+              << "                           (env: CLOXX_GC_MIN_HEAP, default: 4194304)\n"
+              << "  --gc-nursery=BYTES       collect young objects on their own whenever BYTES were allocated,\n"
+              << "                           0 disables generational collection\n"
+              << "                           (env: CLOXX_GC_NURSERY, default: 1048576)\n"
+              << "  --gc-pause-budget=USEC   mark incrementally, pausing for about USEC microseconds at a time,\n"
+              << "                           0 marks the whole heap at once (env: CLOXX_GC_PAUSE_BUDGET, default: 0)\n"
+              << "  --gc-mark-threads=N      mark the whole heap at once with N threads\n"
+              << "                           (env: CLOXX_GC_MARK_THREADS, default: 1)\n"
+              << "  --gc-stats[=FORMAT]      print what the collector did to stderr at exit, FORMAT is\n"
+              << "                           text (default) or json (env: CLOXX_GC_STATS)\n"
+              << "  --gc-heap-snapshot=FILE  write a heap snapshot to FILE at exit, which Chrome DevTools\n"
+              << "                           can load (env: CLOXX_GC_HEAP_SNAPSHOT)\n";
+}
+
+bool parseBackend(char const* str, Settings& settings)
+{
+    if (std::strcmp(str, "interpreter") == 0) {
+        settings.backend = Lox::Backend::INTERPRETER;
+    }
+    else if (std::strcmp(str, "closure") == 0) {
+        settings.backend = Lox::Backend::CLOSURE;
+    }
+    else if (std::strcmp(str, "vm") == 0) {
+        settings.backend = Lox::Backend::VM;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool parseCacheStats(char const* str, Settings& settings)
+{
+    // A flag, which also takes a boolean to turn it off again.
+    if (*str == '\0' || std::strcmp(str, "1") == 0 || std::strcmp(str, "true") == 0) {
+        settings.cacheStats = true;
+    }
+    else if (std::strcmp(str, "0") == 0 || std::strcmp(str, "false") == 0) {
+        settings.cacheStats = false;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool parseHeapGrowth(char const* str, Settings& settings)
+{
+    char* end;
+    auto value = std::strtod(str, &end);
+    if (end == str || *end != '\0' || !(value >= 1.0)) {
+        return false;
+    }
+    settings.gc.heapGrowthFactor = value;
+    return true;
+}
+
+bool parseSize(char const* str, size_t& size)
+{
+    char* end;
+    auto value = std::strtoull(str, &end, 10);
+    if (end == str || *end != '\0' || *str == '-') {
+        return false;
+    }
+    size = static_cast<size_t>(value);
+    return true;
+}
+
+bool parseMinHeap(char const* str, Settings& settings)
+{
+    return parseSize(str, settings.gc.minHeapSize);
+}
+
+bool parseNursery(char const* str, Settings& settings)
+{
+    return parseSize(str, settings.gc.nurserySize);
+}
+
+bool parsePauseBudget(char const* str, Settings& settings)
+{
+    size_t micros;
+    if (!parseSize(str, micros)) {
+        return false;
+    }
+    settings.gc.pauseBudget = std::chrono::microseconds{micros};
+    return true;
+}
+
+bool parseMarkThreads(char const* str, Settings& settings)
+{
+    return parseSize(str, settings.gc.markThreads) && settings.gc.markThreads > 0;
+}
+
+bool parseStats(char const* str, Settings& settings)
+{
+    if (*str == '\0' || std::strcmp(str, "text") == 0) {
+        settings.gc.stats = GCStats::Format::TEXT;
+    }
+    else if (std::strcmp(str, "json") == 0) {
+        settings.gc.stats = GCStats::Format::JSON;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool parseHeapSnapshot(char const* str, Settings& settings)
+{
+    settings.gc.heapSnapshotPath = str;
+    return !settings.gc.heapSnapshotPath.empty();
+}
+
+struct Option {
+    char const* name;
+    char const* env;
+    bool (*parse)(char const* str, Settings& settings);
+};
+
+Option const options[] = {
+    {"--backend", "CLOXX_BACKEND", parseBackend},
+    {"--cache-stats", "CLOXX_CACHE_STATS", parseCacheStats},
+    {"--gc-heap-growth", "CLOXX_GC_HEAP_GROWTH", parseHeapGrowth},
+    {"--gc-min-heap", "CLOXX_GC_MIN_HEAP", parseMinHeap},
+    {"--gc-nursery", "CLOXX_GC_NURSERY", parseNursery},
+    {"--gc-pause-budget", "CLOXX_GC_PAUSE_BUDGET", parsePauseBudget},
+    {"--gc-mark-threads", "CLOXX_GC_MARK_THREADS", parseMarkThreads},
+    {"--gc-stats", "CLOXX_GC_STATS", parseStats},
+    {"--gc-heap-snapshot", "CLOXX_GC_HEAP_SNAPSHOT", parseHeapSnapshot},
+};
+} // namespace
+
 int main(int argc, char const* argv[])
 {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " filepath\n";
+    Settings settings;
+
+    // Environment variables first, so that command line options override them.
+    for (auto& option : options) {
+        if (auto value = std::getenv(option.env); value && !option.parse(value, settings)) {
+            std::cerr << "Error: Invalid value '" << value << "' for " << option.env << "!\n";
+            return 1;
+        }
+    }
+
+    char const* filepath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        auto arg = argv[i];
+        if (std::strncmp(arg, "--", 2) != 0) {
+            if (filepath) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            filepath = arg;
+            continue;
+        }
+
+        // Options take their value after '='. Without one, they get an empty
+        // string, which only flags accept.
+        bool parsed = false;
+        for (auto& option : options) {
+            auto nameLength = std::strlen(option.name);
+            if (std::strncmp(arg, option.name, nameLength) == 0) {
+                auto value = arg + nameLength;
+                if (*value == '=') {
+                    parsed = option.parse(value + 1, settings);
+                }
+                else if (*value == '\0') {
+                    parsed = option.parse(value, settings);
+                }
+                break;
+            }
+        }
+        if (!parsed) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!filepath) {
+        printUsage(argv[0]);
         return 1;
     }
 
-    std::ifstream ifs{argv[1]};
+    std::ifstream ifs{filepath};
     if (!ifs.is_open()) {
-        std::cerr << "Error: Cannot open file '" << argv[1] << "' to read!\n";
+        std::cerr << "Error: Cannot open file '" << filepath << "' to read!\n";
         return 1;
     }
 
@@ -26,14 +222,13 @@ int main(int argc, char const* argv[])
 
     int result;
     {
-        Lox lox;
+        Lox lox{settings.gc, settings.backend, settings.cacheStats};
         result = lox.run(source);
     }
 
 #ifdef CLOXX_GC_DEBUG
-    LOX_ASSERT(LoxObject::instanceCount() == 0);
     LOX_ASSERT(Traceable::instanceCount() == 0);
 #endif
 
     return result;
-}
\ No newline at end of file
+}
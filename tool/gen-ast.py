@@ -3,212 +3,191 @@
 import os.path
 import sys
 
+_baseNames = ['Expr', 'Stmt']
+
+def _isNodeType(type):
+    # A specific kind of node, e.g. FunStmt, as opposed to Expr or Stmt which
+    # refer to nodes of any kind.
+    return type not in _baseNames and any(type.endswith(baseName) for baseName in _baseNames)
+
 def _makeParamType(type):
-    if type == 'LoxObject':
-        return 'std::shared_ptr<LoxObject> const&'
     if type[-1] == '?':
+        if _isNodeType(type[:-1]):
+            return type[:-1] + ' const*'
         return 'std::optional<' + type[:-1] + '> const&'
     if type.startswith('List<'):
-        itemType = type[5:-1]
-        return 'std::vector<' + itemType + '> const&'
+        return _makeMemVarType(type) + ' const&'
     return type + ' const&'
 
 def _makeMemVarType(type):
-    if type == 'LoxObject':
-        return 'std::shared_ptr<LoxObject>'
     if type[-1] == '?':
+        if _isNodeType(type[:-1]):
+            return type[:-1] + ' const*'
         return 'std::optional<' + type[:-1] + '>'
     if type.startswith('List<'):
         itemType = type[5:-1]
+        if _isNodeType(itemType):
+            return 'std::vector<' + itemType + ' const*>'
         return 'std::vector<' + itemType + '>'
+    if _isNodeType(type):
+        return type + ' const&'
     return type
 
-def _declareFactoryFunction(file, node):
-    file.write('    friend ' + node.name + ' make' + node.name + '(')
-    for index, field in enumerate(node.fields):
-        type = _makeParamType(field.type)
-        file.write(type + ' ' + field.name)
-        if index < len(node.fields) - 1:
-           file.write(', ')
-        else:
-           file.write(');\n')
+def _writeParams(file, node):
+    params = node.params()
+    for index, field in enumerate(params):
+        file.write(_makeParamType(field.type) + ' ' + field.name)
+        if index < len(params) - 1:
+            file.write(', ')
 
 def _implementFactoryFunction(file, node):
-    file.write('inline ' + node.name + ' make' + node.name + '(')
-    for index, field in enumerate(node.fields):
-        type = _makeParamType(field.type)
-        file.write(type + ' ' + field.name)
-        if index < len(node.fields) - 1:
-           file.write(', ')
-        else:
-           file.write(')\n')
+    file.write('inline ' + node.name + ' const& make' + node.name + '(AstArena& arena, ')
+    _writeParams(file, node)
+    file.write(')\n')
     file.write('{\n')
-    file.write('    return ' + node.name + '{std::make_shared<' + node.name + '::Data>(')
-    for index, field in enumerate(node.fields):
-        file.write(field.name)
-        if index < len(node.fields) - 1:
-           file.write(', ')
-        else:
-           file.write(')};\n')
+    file.write('    return arena.create<' + node.name + '>(')
+    file.write(', '.join(field.name for field in node.params()))
+    file.write(');\n')
     file.write('}\n')
 
 
 def _defineNode(file, baseName, node):
     # Node class
-    file.write('class ' + node.name + ' final {\n')
+    file.write('class ' + node.name + ' final : public ' + baseName + '::Node {\n')
     file.write('public:\n')
-    file.write('    ' + node.name + '(' + node.name + ' const& other);\n')
+    file.write('    ' + ('explicit ' if len(node.params()) == 1 else '') + node.name + '(')
+    _writeParams(file, node)
+    file.write(');\n')
+    file.write('\n')
+    file.write('    ' + node.name + '(' + node.name + ' const&) = delete;\n')
+    file.write('    ' + node.name + '& operator=(' + node.name + ' const&) = delete;\n')
     file.write('\n')
     for field in node.fields:
-        file.write('    ' + _makeParamType(field.type) + ' ' + field.name + ';\n')
+        if field.isMutable:
+            file.write('    mutable ' + _makeMemVarType(field.type) + ' ' + field.name + '{};\n')
+        else:
+            file.write('    ' + _makeMemVarType(field.type) + ' const ' + field.name + ';\n')
     if node.needsResolving:
         file.write('\n')
         file.write('    int depth() const;\n')
-        file.write('    void resolve(int depth);\n')
-    file.write('\n')
-    file.write('private:\n')
-    file.write('    friend class ' + baseName + ';\n')
-    _declareFactoryFunction(file, node)
-    file.write('\n')
-    file.write('    struct Data;\n')
-    file.write('    std::shared_ptr<Data> _data;\n')
-    file.write('\n')
-    file.write('    explicit ' + node.name + '(std::shared_ptr<Data> const& data);\n')
-    file.write('};\n')
-    file.write('\n')
-
-    # Data class
-    file.write('struct ' + node.name + '::Data : ' + baseName + '::Data, std::enable_shared_from_this<Data> {\n')
-    file.write('    Data(')
-    for index, field in enumerate(node.fields):
-        type = _makeParamType(field.type)
-        file.write(type + ' ' + field.name)
-        if index < len(node.fields) - 1:
-           file.write(', ')
-        else:
-           file.write(')\n')
-    file.write('        : ')
-    for index, field in enumerate(node.fields):
-        file.write(field.name + '{' + field.name + '}')
-        if index < len(node.fields) - 1:
-            file.write(', ')
-        else:
-            file.write('\n')
-    file.write('    {}\n')
-    file.write('\n')
-    file.write('    void accept(' + baseName + 'Visitor& visitor) override\n')
-    file.write('    {\n')
-    file.write('        visitor.visit(' + node.name + '{shared_from_this()});\n')
-    file.write('    }\n')
-    file.write('\n')
-    for field in node.fields:
-        type = _makeMemVarType(field.type);
-        file.write('    ' + type + ' ' + field.name + ';\n')
-    if node.needsResolving:
-        file.write('    int depth;\n')
+        file.write('    int slot() const;\n')
+        file.write('    void resolve(int depth, int slot);\n')
+        file.write('\n')
+        file.write('private:\n')
+        file.write('    int _depth = -1;\n')
+        file.write('    int _slot = -1;\n')
     file.write('};\n')
     file.write('\n')
 
-    # Node constructors
-    file.write('inline ' + node.name + '::' + node.name +  '(' + node.name + ' const& other)\n')
-    file.write('    : ')
-    for field in node.fields:
-        file.write(field.name + '{other.' + field.name + '}, ')
-    file.write('_data{other._data} {}\n')
+    # Node constructor
+    file.write('inline ' + node.name + '::' + node.name + '(')
+    _writeParams(file, node)
+    file.write(')\n')
+    file.write('    : Node{' + baseName + '::Kind::' + node.kind + '}')
+    for field in node.params():
+        file.write(', ' + field.name + '{' + field.name + '}')
     file.write('\n')
-    file.write('inline ' + node.name + '::' + node.name +  '(std::shared_ptr<Data> const& data)\n')
-    file.write('    : ')
-    for field in node.fields:
-        file.write(field.name + '{data->' + field.name + '}, ')
-    file.write('_data{data} {}\n')
+    file.write('{}\n')
 
     if node.needsResolving:
         file.write('\n')
         file.write('inline int ' + node.name + '::depth() const\n')
         file.write('{\n')
-        file.write('    return _data->depth;\n')
+        file.write('    return _depth;\n')
+        file.write('}\n')
+        file.write('\n')
+        file.write('inline int ' + node.name + '::slot() const\n')
+        file.write('{\n')
+        file.write('    return _slot;\n')
         file.write('}\n')
         file.write('\n')
-        file.write('inline void ' + node.name + '::resolve(int depth)\n')
+        file.write('inline void ' + node.name + '::resolve(int depth, int slot)\n')
         file.write('{\n')
-        file.write('    _data->depth = depth;\n')
+        file.write('    _depth = depth;\n')
+        file.write('    _slot = slot;\n')
         file.write('}\n')
 
 
-def _defineAst(file, headers, baseName, nodes):
+def _implementAccept(file, baseName, visitor, nodes):
+    file.write('inline ' + visitor.returnType + ' ' + baseName + '::accept(' + baseName + visitor.name +
+               '& visitor) const\n')
+    file.write('{\n')
+    file.write('    switch (_node->kind) {\n')
+    for node in nodes:
+        file.write('    case Kind::' + node.kind + ':\n')
+        file.write('        ' + visitor.returnStatement() + 'visitor.visit(static_cast<' + node.name +
+                   ' const&>(*_node));\n')
+        if visitor.returnType == 'void':
+            file.write('        return;\n')
+    file.write('    }\n')
+    if visitor.returnType != 'void':
+        file.write('    return {}; // unreachable\n')
+    file.write('}\n')
+
+
+def _defineAst(file, headers, baseName, visitors, nodes):
     file.write('// This is auto-generated by ' + os.path.basename(__file__) + '. Do not modify manually.\n')
     file.write('\n')
     file.write('#pragma once\n')
     file.write('\n')
+    file.write('#include <cstdint>\n')
     file.write('#include <optional>\n')
-    file.write('#include <memory>\n')
     file.write('#include <vector>\n')
     file.write('\n')
+    file.write('#include "AstArena.hpp"\n')
     for header in headers:
         file.write('#include "' + header + '"\n')
     file.write('\n')
     file.write('namespace cloxx {\n')
     file.write('\n')
-    
+
     # Forward declare types.
     for node in nodes:
         file.write('class ' + node.name + ';\n')
     file.write('\n')
 
-    # Define Visitor
-    file.write('class ' + baseName + 'Visitor {\n')
-    file.write('public:\n')
-    file.write('    virtual ~' + baseName + 'Visitor() = default;\n')
-    file.write('\n')
-    for node in nodes:
-        file.write('    virtual void visit(' + node.name + ' const&) = 0;\n')
-    file.write('};\n')
-    file.write('\n')
-    
+    # Define Visitors
+    for visitor in visitors:
+        file.write('class ' + baseName + visitor.name + ' {\n')
+        file.write('public:\n')
+        file.write('    virtual ~' + baseName + visitor.name + '() = default;\n')
+        file.write('\n')
+        for node in nodes:
+            file.write('    virtual ' + visitor.returnType + ' visit(' + node.name + ' const&) = 0;\n')
+        file.write('};\n')
+        file.write('\n')
+
     # Begin the base class.
+    file.write('// Refers to a node of any kind. Nodes are created in an AstArena, which owns\n')
+    file.write('// them, and are visited by switching on their kind.\n')
     file.write('class ' + baseName + ' final {\n')
     file.write('public:\n')
-
-    # Node to Base conversion
+    file.write('    enum class Kind : std::uint8_t {\n')
     for node in nodes:
-        file.write('    ' + baseName + '(' + node.name + ' const& other);\n')
+        file.write('        ' + node.kind + ',\n')
+    file.write('    };\n')
     file.write('\n')
-
-    for node in nodes:
-        file.write('    std::optional<' + node.name + '> to' + node.name + '() const;\n')
+    file.write('    struct Node {\n')
+    file.write('        Kind const kind;\n')
+    file.write('    };\n')
     file.write('\n')
 
     # Node to Base conversion
-    file.write('    template <typename T>\n')
-    file.write('    ' + baseName + '& operator=(T const& rhs)\n')
-    file.write('    {\n')
-    file.write('        _data = rhs._data;\n')
-    file.write('        return *this;\n')
-    file.write('    }\n')
-    file.write('\n')
-    
-    # Declare accept() forwarding
-    file.write('    void accept(' + baseName + 'Visitor& visitor) const\n')
-    file.write('    {\n')
-    file.write('        _data->accept(visitor);\n')
-    file.write('    }\n')
+    for node in nodes:
+        file.write('    ' + baseName + '(' + node.name + ' const& node);\n')
     file.write('\n')
 
-    file.write('private:\n')
-
     for node in nodes:
-        file.write('    friend class ' + node.name + ';\n')
+        file.write('    ' + node.name + ' const* to' + node.name + '() const;\n')
     file.write('\n')
 
-    file.write('    struct Data;\n')
-    file.write('    explicit ' + baseName + '(std::shared_ptr<Data> const& impl) : _data{impl} {}\n')
+    # Declare accept()
+    for visitor in visitors:
+        file.write('    ' + visitor.returnType + ' accept(' + baseName + visitor.name + '& visitor) const;\n')
     file.write('\n')
 
-    file.write('    struct Data {\n')
-    file.write('        virtual ~Data() = default;\n')
-    file.write('        virtual void accept(' + baseName + 'Visitor& visitor) = 0;\n')
-    file.write('    };\n')
-    file.write('    std::shared_ptr<Data> _data;\n')
+    file.write('private:\n')
+    file.write('    Node const* _node;\n')
     file.write('};\n')
     file.write('\n')
 
@@ -217,32 +196,47 @@ def _defineAst(file, headers, baseName, nodes):
         file.write('\n')
         _implementFactoryFunction(file, node)
         file.write('\n')
-        file.write('inline std::optional<' + node.name + '> ' + baseName + '::to' + node.name + '() const\n')
+        file.write('inline ' + baseName + '::' + baseName + '(' + node.name + ' const& node) : _node{&node}\n')
+        file.write('{}\n')
+        file.write('\n')
+        file.write('inline ' + node.name + ' const* ' + baseName + '::to' + node.name + '() const\n')
         file.write('{\n')
-        file.write('    if (auto data = std::dynamic_pointer_cast<' + node.name + '::Data>(_data)) {\n')
-        file.write('        return ' + node.name + '{data};\n')
+        file.write('    if (_node->kind == Kind::' + node.kind + ') {\n')
+        file.write('        return static_cast<' + node.name + ' const*>(_node);\n')
         file.write('    }\n')
-        file.write('    return std::nullopt;\n')
+        file.write('    return nullptr;\n')
         file.write('}\n')
         file.write('\n')
-        file.write('inline ' + baseName + '::' + baseName + '(' + node.name + ' const& other)\n')
-        file.write('{\n')
-        file.write('    _data = other._data;\n')
-        file.write('}\n')
+
+    for visitor in visitors:
+        _implementAccept(file, baseName, visitor, nodes)
         file.write('\n')
-    file.write('\n')
 
     file.write('} // cloxx\n')
 
 
+class Visitor:
+    def __init__(self, name, returnType):
+        self.name = name
+        self.returnType = returnType
+
+    def returnStatement(self):
+        return '' if self.returnType == 'void' else 'return '
+
+
 class Field:
     def __init__(self, spec):
-        tokens = spec.split(' ')
+        tokens = spec.split()
+        # Mutable fields are filled in after parsing, like what the resolver
+        # found out or caches of the backends. They start value initialized.
+        self.isMutable = tokens[0] == 'mutable'
+        if self.isMutable:
+            tokens = tokens[1:]
         self.type = tokens[0].strip()
         self.name = tokens[1].strip()
 
     def __str__(self):
-        return self.type + ' ' + self.name
+        return ('mutable ' if self.isMutable else '') + self.type + ' ' + self.name
 
 
 class Node:
@@ -255,21 +249,25 @@ class Node:
         else:
             self.needsResolving = False
         self.name = prefix + baseName
+        self.kind = prefix.upper()
         self.fields = []
         for fieldSpec in [x.strip() for x in tokens[1].split(',')]:
             self.fields.append(Field(fieldSpec))
 
+    def params(self):
+        return [field for field in self.fields if not field.isMutable]
+
     def __str__(self):
         return self.name + ': ' + ', '.join([str(field) for field in self.fields])
 
-def _generateAst(outputDir, headers, baseName, nodeSpecs):
+def _generateAst(outputDir, headers, baseName, visitors, nodeSpecs):
     nodes = []
     for nodeSpec in nodeSpecs:
         nodes.append(Node(baseName, nodeSpec))
     # for node in nodes:
     #     print(node)
     with open(os.path.join(outputDir, baseName + '.hpp'), 'w') as file:
-       _defineAst(file, headers, baseName, nodes)
+       _defineAst(file, headers, baseName, visitors, nodes)
 
 if __name__ == '__main__':
     if len(sys.argv) != 2:
@@ -277,15 +275,20 @@ if __name__ == '__main__':
 
     outputDir = sys.argv[1]
 
-    _generateAst(outputDir, ['Token.hpp'], 'Expr', [
+    # Evaluating expressions is hot, so evaluators return the value of each
+    # visit instead of passing it back through some container.
+    _generateAst(outputDir, ['PropertyCache.hpp', 'Token.hpp'], 'Expr', [
+        Visitor('Visitor', 'void'),
+        Visitor('Evaluator', 'Value'),
+    ], [
         "Assign^   : Token name, Expr value",
         "Binary    : Token op, Expr left, Expr right",
         "Call      : Expr callee, Token paren, List<Expr> args",
-        "Get       : Expr object, Token name",
+        "Get       : Expr object, Token name, mutable PropertyCache cache",
         "Grouping  : Expr expr",
-        "Literal   : LoxObject value",
+        "Literal   : Value value",
         "Logical   : Token op, Expr left, Expr right",
-        "Set       : Expr object, Token name, Expr value",
+        "Set       : Expr object, Token name, Expr value, mutable PropertyCache cache",
         "This^     : Token keyword",
         "Super^    : Token keyword, Token method",
         "Unary     : Token op, Expr right",
@@ -293,13 +296,15 @@ if __name__ == '__main__':
     ])
 
     _generateAst(outputDir, ['Token.hpp', 'Expr.hpp'], 'Stmt', [
-        "Block  : List<Stmt> stmts",
+        Visitor('Visitor', 'void'),
+    ], [
+        "Block  : List<Stmt> stmts, mutable List<bool> captured",
         "Expr   : Expr expr",
         "If     : Expr cond, Stmt thenBranch, Stmt? elseBranch",
         "While  : Expr cond, Stmt body",
         "Return : Token keyword, Expr? value",
         "Print  : Expr expr",
-        "Var    : Token name, Expr? initializer",
-        "Fun    : Token name, List<Token> params, List<Stmt> body",
-        "Class  : Token name, VariableExpr? superclass, List<FunStmt> methods",
+        "Var^   : Token name, Expr? initializer",
+        "Fun^   : Token name, List<Token> params, List<Stmt> body, mutable size_t frameSize, mutable List<bool> captured",
+        "Class^ : Token name, VariableExpr? superclass, List<FunStmt> methods",
     ])
\ No newline at end of file
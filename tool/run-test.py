@@ -4,6 +4,7 @@ import os
 import re
 import subprocess
 import sys
+import tempfile
 
 # This python script was ported from the Crafting Interpreters' test runner written dart.
 # The original test runner code can be found at:
@@ -18,6 +19,11 @@ _expectedRuntimeErrorPattern = re.compile(r"// expect runtime error: (.+)")
 _syntaxErrorPattern = re.compile(r"\[.*line (\d+)\] (Error.+)")
 _nonTestPattern = re.compile(r"// nontest")
 
+# Options to run a test with, and regular expressions for lines it should
+# print to stderr in that order, for tests of the interpreter's options.
+_argsPattern = re.compile(r"// args: (.+)")
+_expectedStderrPattern = re.compile(r"// expect stderr: (.+)")
+
 _passed = 0
 _failed = 0
 _skipped = 0
@@ -52,9 +58,10 @@ class term:
         print("\033[1000D\033[0K" + text, end='', flush=True)
 
 class Suite:
-  def __init__(this, name, tests):
+  def __init__(this, name, tests, args = []):
       this.name = name
       this.tests = tests
+      this.args = args
 
 def _runSuite(name):
     global _suite, _passed, _failed, _skipped, _expectations
@@ -118,6 +125,8 @@ class Test:
     def __init__(this, path):
         this._path = path
         this._expectedOutputs = []
+        this._args = []
+        this._expectedStderr = []
 
         # The set of expected compile error messages.
         this._expectedErrors = set()
@@ -171,6 +180,17 @@ class Test:
                 _expectations += 1
                 continue
 
+            match = _argsPattern.search(line)
+            if match is not None:
+                this._args.extend(match[1].split())
+                continue
+
+            match = _expectedStderrPattern.search(line)
+            if match is not None:
+                this._expectedStderr.append(ExpectedOutput(lineNum, match[1]))
+                _expectations += 1
+                continue
+
             match = _expectedErrorPattern.search(line)
             if match is not None:
                 this._expectedErrors.add("[line {}] {}".format(lineNum, match[1]))
@@ -215,7 +235,10 @@ class Test:
     def run(this):
         global _executable
 
-        result = subprocess.run([_executable, this._path], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        # Run in a directory of its own, where a test may leave files behind.
+        with tempfile.TemporaryDirectory() as directory:
+            args = [os.path.abspath(_executable)] + _suite.args + this._args + [os.path.abspath(this._path)]
+            result = subprocess.run(args, cwd=directory, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
 
         # Normalize Windows line endings.
         outputLines = result.stdout.decode('utf-8').split('\n')
@@ -224,6 +247,8 @@ class Test:
         # Validate that an expected runtime error occurred.
         if this._expectedRuntimeError is not None:
             this._validateRuntimeError(errorLines)
+        elif len(this._expectedStderr) > 0:
+            this._validateStderr(errorLines)
         else:
             this._validateCompileErrors(errorLines)
 
@@ -240,6 +265,19 @@ class Test:
             this._fail("Expected runtime error '{}' and got:".format(this._expectedRuntimeError))
             this._fail(errorLines[0])
 
+    def _validateStderr(this, errorLines):
+        # Other lines may come in between, so that a test need not spell out
+        # everything an option prints.
+        index = 0
+        for line in errorLines:
+            if index < len(this._expectedStderr) and re.fullmatch(this._expectedStderr[index].output, line):
+                index += 1
+
+        while index < len(this._expectedStderr):
+            expected = this._expectedStderr[index]
+            this._fail("Missing expected stderr '{}' on line {}.".format(expected.output, expected.line))
+            index += 1
+
     def _validateCompileErrors(this, errorLines):
         # Validate that every compile error was expected.
         foundErrors = set()
@@ -331,8 +369,10 @@ def _defineTestSuites():
         noJavaLimits
     )
 
-    # cloxx behaves like jlox
-    _allSuites["cloxx"] = Suite("cloxx", jloxTests)
+    # cloxx behaves like jlox, whichever backend runs the program
+    _allSuites["cloxx"] = Suite("cloxx", jloxTests, ["--backend=interpreter"])
+    _allSuites["cloxx-closure"] = Suite("cloxx-closure", jloxTests, ["--backend=closure"])
+    _allSuites["cloxx-vm"] = Suite("cloxx-vm", jloxTests, ["--backend=vm"])
 
     # more suites can go here...
 
@@ -343,9 +383,14 @@ def main():
     
     _defineTestSuites()
     if len(sys.argv) == 2:
-        _runSuite(sys.argv[1])
+        passed = _runSuite(sys.argv[1])
     else:
-        _runSuite('cloxx')
+        passed = True
+        for name in _allSuites:
+            passed = _runSuite(name) and passed
+
+    if not passed:
+        sys.exit(1)
 
 if __name__ == '__main__':
     main()